@@ -24,6 +24,8 @@
  *
  * */
 
+#include <string.h>
+
 #include "ch.h"
 #include "hal.h"
 #include "eicu.h" /* Should be in hal.h but is not a part of ChibiOS */
@@ -35,6 +37,11 @@
 /* Driver local definitions.                                                 */
 /*===========================================================================*/
 
+/**
+ * @brief   Nanoseconds per tick scale, 1e12 mHz.ns in 40.24 fixed point.
+ */
+#define EICU_TIMEBASE_NS_SCALE              (1000000000000ULL << 24)
+
 /*===========================================================================*/
 /* Driver exported variables.                                                */
 /*===========================================================================*/
@@ -47,6 +54,79 @@
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 
+#if EICU_USE_TIMEBASE || defined(__DOXYGEN__)
+/**
+ * @brief   Publishes a new timer clock estimate.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] rate      The timer clock in mHz
+ *
+ * @notapi
+ */
+static void eicu_timebase_set(EICUDriver *eicup, uint64_t rate) {
+  EICUTimebase *tbp = &eicup->timebase;
+
+  tbp->seq++;
+  __DMB();
+  tbp->rate = rate;
+  tbp->nsq  = EICU_TIMEBASE_NS_SCALE / rate;
+  __DMB();
+  tbp->seq++;
+}
+
+/**
+ * @brief   Reads a consistent timer clock estimate.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[out] ratep    Pointer to the timer clock in mHz, can be @p NULL
+ * @param[out] nsqp     Pointer to the nanoseconds per tick, can be @p NULL
+ *
+ * @notapi
+ */
+static void eicu_timebase_get(EICUDriver *eicup, uint64_t *ratep,
+                              uint64_t *nsqp) {
+  const EICUTimebase *tbp = &eicup->timebase;
+  uint64_t rate, nsq;
+  uint32_t seq;
+
+  do {
+    seq = tbp->seq;
+    __DMB();
+    rate = tbp->rate;
+    nsq  = tbp->nsq;
+    __DMB();
+  } while (((seq & 1U) != 0) || (seq != tbp->seq));
+
+  if (ratep != NULL)
+    *ratep = rate;
+  if (nsqp != NULL)
+    *nsqp = nsq;
+}
+#endif
+
+/**
+ * @brief   Resets the measurement buffers and enables the capture.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ *
+ * @notapi
+ */
+static void eicu_enable(EICUDriver *eicup) {
+
+#if EICU_USE_QUEUE
+  eicup->qwr = 0;
+  eicup->qrd = 0;
+#endif
+#if EICU_USE_PPM
+  eicup->ppm.count[0] = 0;
+  eicup->ppm.count[1] = 0;
+  eicup->ppm.front    = 0;
+  eicup->ppm.pos      = EICU_PPM_NOSYNC;
+#endif
+  eicu_lld_enable(eicup);
+  eicup->state = EICU_WAITING;
+}
+
 /*===========================================================================*/
 /* Driver exported functions.                                                */
 /*===========================================================================*/
@@ -73,6 +153,26 @@ void eicuObjectInit(EICUDriver *eicup) {
 
   eicup->state  = EICU_STOP;
   eicup->config = NULL;
+#if EICU_USE_QUEUE
+  eicup->qwr    = 0;
+  eicup->qrd    = 0;
+  eicup->thread = NULL;
+#endif
+#if EICU_USE_PPM
+  eicup->ppm.seq = 0;
+#endif
+#if EICU_USE_EVENTS
+  osalEventObjectInit(&eicup->event);
+  eicup->eflags = 0;
+#endif
+#if EICU_USE_SNAPSHOTS
+  {
+    size_t n;
+
+    for (n = 0; n < 4; n++)
+      eicup->channels[n].seq = 0;
+  }
+#endif
 }
 
 /**
@@ -91,6 +191,22 @@ void eicuStart(EICUDriver *eicup, const EICUConfig *config) {
   osalDbgAssert((eicup->state == EICU_STOP) || (eicup->state == EICU_READY),
                 "invalid state");
   eicup->config = config;
+#if EICU_USE_STATISTICS
+  memset(&eicup->stats, 0, sizeof (EICUStats));
+#endif
+#if EICU_USE_QUEUE
+  /* The ISR wraps the write index with a mask.*/
+  osalDbgAssert((config->queue_buffer == NULL) ||
+                ((config->queue_size != 0) &&
+                 ((config->queue_size & (config->queue_size - 1)) == 0)),
+                "queue size not a power of two");
+  eicup->qbuf  = config->queue_buffer;
+  eicup->qsize = config->queue_size;
+#endif
+#if EICU_USE_TIMEBASE
+  eicup->timebase.count = 0;
+  eicu_timebase_set(eicup, (uint64_t)config->frequency * 1000U);
+#endif
   eicu_lld_start(eicup);
   eicup->state = EICU_READY;
   osalSysUnlock();
@@ -117,6 +233,9 @@ void eicuStop(EICUDriver *eicup) {
 
 /**
  * @brief   Enables the extended input capture.
+ * @note    Slaves of a synchronized group are enabled with their master by
+ *          @p eicuEnableSynchronized() instead, alone they would wait for
+ *          a trigger that never comes.
  *
  * @param[in] eicup     Pointer to the @p EICUDriver object
  *
@@ -128,8 +247,41 @@ void eicuEnable(EICUDriver *eicup) {
 
   osalSysLock();
   osalDbgAssert(eicup->state == EICU_READY, "invalid state");
-  eicu_lld_enable(eicup);
-  eicup->state = EICU_WAITING;
+  osalDbgAssert(eicup->config->sync != EICU_SYNC_SLAVE,
+                "slave enabled without its master");
+  eicu_enable(eicup);
+  osalSysUnlock();
+}
+
+/**
+ * @brief   Enables a group of synchronized timers.
+ * @details The slaves are armed first, then the master counter enable
+ *          starts all the counters on the same clock edge, so their
+ *          timestamps share the same timebase.
+ *
+ * @param[in] masterp   Pointer to the master @p EICUDriver object
+ * @param[in] slavesp   Array of pointers to the slave @p EICUDriver objects
+ * @param[in] n         Number of slaves
+ *
+ * @api
+ */
+void eicuEnableSynchronized(EICUDriver *masterp, EICUDriver *const *slavesp,
+                            size_t n) {
+  size_t i;
+
+  osalDbgCheck((masterp != NULL) && ((slavesp != NULL) || (n == 0)));
+
+  osalSysLock();
+  osalDbgAssert((masterp->state == EICU_READY) &&
+                (masterp->config->sync == EICU_SYNC_MASTER),
+                "invalid master");
+  for (i = 0; i < n; i++) {
+    osalDbgAssert((slavesp[i]->state == EICU_READY) &&
+                  (slavesp[i]->config->sync == EICU_SYNC_SLAVE),
+                  "invalid slave");
+    eicu_enable(slavesp[i]);
+  }
+  eicu_enable(masterp);
   osalSysUnlock();
 }
 
@@ -150,7 +302,365 @@ void eicuDisable(EICUDriver *eicup) {
                  "invalid state");
   eicu_lld_disable(eicup);
   eicup->state = EICU_READY;
+#if EICU_USE_QUEUE
+  osalThreadResumeI(&eicup->thread, MSG_RESET);
+  osalOsRescheduleS();
+#endif
+  osalSysUnlock();
+}
+
+#if EICU_USE_STATISTICS || defined(__DOXYGEN__)
+/**
+ * @brief   Returns a snapshot of the interrupt statistics.
+ * @details The counters accumulate from @p eicuStart(), they can be used to
+ *          size interrupt priorities and prescalers.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[out] statsp   Pointer to the @p EICUStats destination
+ *
+ * @api
+ */
+void eicuGetStats(EICUDriver *eicup, EICUStats *statsp) {
+
+  osalDbgCheck((eicup != NULL) && (statsp != NULL));
+
+  osalSysLock();
+  *statsp = eicup->stats;
   osalSysUnlock();
 }
+#endif /* EICU_USE_STATISTICS */
+
+#if EICU_USE_QUEUE || defined(__DOXYGEN__)
+/**
+ * @brief   Drains measurements from the capture queue.
+ * @details The calling thread sleeps until @p n records are queued or the
+ *          timeout expires, then copies out the available records, at most
+ *          @p n. The ISR side never blocks, a single consumer thread per
+ *          driver is supported.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[out] buf      Pointer to the destination records
+ * @param[in] n         Number of records wanted, at most the queue size
+ * @param[in] timeout   The number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The number of records copied, less than @p n only
+ *                      on timeout or if the driver was disabled.
+ *
+ * @api
+ */
+size_t eicuWaitCaptures(EICUDriver *eicup, EICUCapture *buf, size_t n,
+                        systime_t timeout) {
+  const EICUCapture *qp;
+  size_t rd, avail, mask, i;
+
+  osalDbgCheck((eicup != NULL) && (buf != NULL) && (n > 0));
+  osalDbgAssert((eicup->config != NULL) && (eicup->qbuf != NULL) &&
+                (n <= eicup->qsize), "queue not configured");
+
+  osalSysLock();
+  osalDbgAssert(eicup->thread == NULL, "already waiting");
+  if ((eicup->qwr - eicup->qrd < n) && (timeout != TIME_IMMEDIATE) &&
+      (eicup->state != EICU_READY)) {
+    eicup->qwanted = n;
+    (void) osalThreadSuspendTimeoutS(&eicup->thread, timeout);
+  }
+  osalSysUnlock();
+
+  /* Only the consumer moves the read index, the records up to the write
+     index are stable.*/
+  qp    = eicup->qbuf;
+  mask  = eicup->qsize - 1;
+  rd    = eicup->qrd;
+  avail = eicup->qwr - rd;
+  if (avail > n)
+    avail = n;
+  for (i = 0; i < avail; i++)
+    buf[i] = qp[(rd + i) & mask];
+  __DMB();
+  eicup->qrd = rd + avail;
+
+  return avail;
+}
+#endif /* EICU_USE_QUEUE */
+
+#if EICU_USE_SNAPSHOTS || defined(__DOXYGEN__)
+/**
+ * @brief   Reads the latest measurement of a channel.
+ * @details The copy is lock-free, it is retried if the ISR updated the
+ *          snapshot meanwhile, so width, period and timestamp always belong
+ *          to the same measurement.
+ * @note    This function can be called from any context.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel to read
+ * @param[out] snp      Pointer to the @p EICUSnapshot destination
+ * @return              The number of measurements published on the
+ *                      channel, zero if none yet.
+ *
+ * @special
+ */
+uint32_t eicuGetSnapshot(EICUDriver *eicup, eicuchannel_t channel,
+                         EICUSnapshot *snp) {
+  const EICUChannel *chp;
+  uint32_t seq;
+
+  osalDbgCheck((eicup != NULL) && (channel <= EICU_CHANNEL_4) &&
+               (snp != NULL));
+
+  chp = &eicup->channels[channel];
+  do {
+    seq = chp->seq;
+    __DMB();
+    *snp = chp->snapshot;
+    __DMB();
+  } while (((seq & 1U) != 0) || (seq != chp->seq));
+
+  return seq / 2;
+}
+#endif /* EICU_USE_SNAPSHOTS */
+
+#if EICU_USE_AGGREGATION || defined(__DOXYGEN__)
+/**
+ * @brief   Adds the latest width of a channel to its aggregation window.
+ * @details The window is closed when it holds @p agg_samples widths or
+ *          spans @p agg_ticks, its totals then become readable through
+ *          @p eicuGetAggregate().
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel that fired the interrupt
+ * @return              The window was closed and must be reported.
+ *
+ * @notapi
+ */
+bool _eicu_aggregate(EICUDriver *eicup, eicuchannel_t channel) {
+  EICUChannel *chp = &eicup->channels[channel];
+  EICUAggregate *accp = &chp->acc;
+  eicutstamp_t width = chp->width;
+
+  if (accp->count == 0) {
+    chp->agg_start = chp->stamp;
+    accp->min      = width;
+    accp->max      = width;
+    accp->sum      = 0;
+    accp->sumsq    = 0;
+  }
+  else if (width < accp->min)
+    accp->min = width;
+  else if (width > accp->max)
+    accp->max = width;
+  accp->count++;
+  accp->sum   += width;
+  accp->sumsq += (uint64_t)width * width;
+
+  /* Without any limit each width closes its own window.*/
+  if (((chp->agg_samples != 0) || (chp->agg_ticks != 0)) &&
+      ((chp->agg_samples == 0) || (accp->count < chp->agg_samples)) &&
+      ((chp->agg_ticks == 0) || (chp->stamp - chp->agg_start < chp->agg_ticks)))
+    return false;
+
+  chp->agg    = *accp;
+  accp->count = 0;
+  return true;
+}
+#endif /* EICU_USE_AGGREGATION */
+
+#if EICU_USE_DEADBAND || defined(__DOXYGEN__)
+/**
+ * @brief   Checks the latest measurement of a channel against its deadband.
+ * @details A reported measurement becomes the reference of the next ones
+ *          of the same event.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel that fired the interrupt
+ * @param[in] ev        @p EICU_DEADBAND_WIDTH or @p EICU_DEADBAND_PERIOD
+ * @return              The measurement must be reported.
+ *
+ * @notapi
+ */
+bool _eicu_deadband(EICUDriver *eicup, eicuchannel_t channel, uint32_t ev) {
+  EICUChannel *chp = &eicup->channels[channel];
+  EICUDeadband *dbp = &chp->db[ev];
+  eicuinterval_t dw, dp;
+
+  if ((chp->deadband_width == 0) && (chp->deadband_period == 0))
+    return true;
+
+  if (dbp->valid) {
+    /* Signed differences, interval widths can be negative.*/
+    dw = (eicuinterval_t)(chp->width - dbp->width);
+    dp = (eicuinterval_t)(chp->period - dbp->period);
+    if (dw < 0)
+      dw = -dw;
+    if (dp < 0)
+      dp = -dp;
+    if (((chp->deadband_width == 0) ||
+         ((eicutstamp_t)dw <= chp->deadband_width)) &&
+        ((chp->deadband_period == 0) ||
+         ((eicutstamp_t)dp <= chp->deadband_period)) &&
+        ((chp->deadband_refresh == 0) ||
+         (chp->stamp - dbp->stamp < chp->deadband_refresh)))
+      return false;
+  }
+
+  dbp->width  = chp->width;
+  dbp->period = chp->period;
+  dbp->stamp  = chp->stamp;
+  dbp->valid  = true;
+  return true;
+}
+#endif /* EICU_USE_DEADBAND */
+
+#if EICU_USE_TIMEBASE || defined(__DOXYGEN__)
+/**
+ * @brief   Updates the timebase with the latest reference period.
+ * @details The first accepted period sets the estimate, the following ones
+ *          correct it by a fraction of their error.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The reference channel that fired the interrupt
+ * @return              The period was accepted and must be reported.
+ *
+ * @notapi
+ */
+bool _eicu_timebase_update(EICUDriver *eicup, eicuchannel_t channel) {
+  const EICUChannel *chp = &eicup->channels[channel];
+  EICUTimebase *tbp = &eicup->timebase;
+  uint64_t rate;
+  int64_t err;
+
+  /* Timer clock seen over this reference period, in mHz.*/
+  rate = (uint64_t)chp->period * 1000000000U / chp->ref_period;
+  err  = (int64_t)(rate - tbp->rate);
+
+  /* Glitches and missed edges are off by far more than any clock drift.*/
+  if ((uint64_t)((err < 0) ? -err : err) > (tbp->rate >> 10))
+    return false;
+
+  if (tbp->count++ > 0)
+    rate = tbp->rate + err / ((int64_t)1 << chp->ref_filter);
+  eicu_timebase_set(eicup, rate);
+  return true;
+}
+
+/**
+ * @brief   Returns the measured timer clock.
+ * @note    This function can be called from any context.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @return              The timer clock in mHz, the nominal one until a
+ *                      reference period is accepted.
+ *
+ * @special
+ */
+uint64_t eicuGetClock(EICUDriver *eicup) {
+  uint64_t rate;
+
+  osalDbgCheck(eicup != NULL);
+
+  eicu_timebase_get(eicup, &rate, NULL);
+  return rate;
+}
+
+/**
+ * @brief   Converts a duration in ticks to nanoseconds.
+ * @details The measured timer clock is used, so the result follows the
+ *          reference instead of the timer crystal.
+ * @note    Durations up to about 1000 seconds are supported.
+ * @note    This function can be called from any context.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] ticks     The duration in ticks
+ * @return              The duration in nanoseconds.
+ *
+ * @special
+ */
+uint64_t eicuTicksToNs(EICUDriver *eicup, eicutstamp_t ticks) {
+  uint64_t nsq;
+
+  osalDbgCheck(eicup != NULL);
+
+  eicu_timebase_get(eicup, NULL, &nsq);
+  return ((uint64_t)ticks * nsq) >> 24;
+}
+
+/**
+ * @brief   Converts a number of input cycles over a duration to a
+ *          frequency.
+ * @details The measured timer clock is used, so the result follows the
+ *          reference instead of the timer crystal. A PWM or edge period is
+ *          one cycle, a frequency counter gate is its width and count.
+ * @note    The product of @p cycles and the timer clock in Hz must stay
+ *          below 1.8e13.
+ * @note    This function can be called from any context.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] ticks     The duration in ticks
+ * @param[in] cycles    The number of input cycles in the duration
+ * @return              The frequency in uHz, zero for a zero duration.
+ *
+ * @special
+ */
+uint64_t eicuTicksToMicroHz(EICUDriver *eicup, eicutstamp_t ticks,
+                            uint32_t cycles) {
+  uint64_t rate;
+
+  osalDbgCheck(eicup != NULL);
+
+  if (ticks == 0)
+    return 0;
+  eicu_timebase_get(eicup, &rate, NULL);
+  return rate * 1000U * cycles / ticks;
+}
+#endif /* EICU_USE_TIMEBASE */
+
+#if EICU_USE_PPM || defined(__DOXYGEN__)
+/**
+ * @brief   Reads the latest complete PPM frame.
+ * @details The copy is lock-free, it is retried if the ISR published a new
+ *          frame meanwhile, so all the values belong to the same frame.
+ * @note    This function can be called from any context, including the
+ *          frame callback.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[out] values   Pointer to the destination channel values in ticks
+ * @param[in] n         Maximum number of channel values to copy
+ * @param[out] seqp     Pointer to the sequence number of the frame, can be
+ *                      @p NULL
+ * @return              The number of channel values copied, zero if no
+ *                      frame was decoded yet.
+ *
+ * @special
+ */
+size_t eicuReadPPM(EICUDriver *eicup, uint32_t *values, size_t n,
+                   uint32_t *seqp) {
+  const EICUPPM *ppmp;
+  uint32_t seq;
+  size_t count, i;
+  uint8_t front;
+
+  osalDbgCheck((eicup != NULL) && (values != NULL));
+
+  ppmp = &eicup->ppm;
+  do {
+    seq = ppmp->seq;
+    __DMB();
+    front = ppmp->front;
+    count = ppmp->count[front];
+    if (count > n)
+      count = n;
+    for (i = 0; i < count; i++)
+      values[i] = ppmp->values[front][i];
+    __DMB();
+  } while (seq != ppmp->seq);
+
+  if (seqp != NULL)
+    *seqp = seq;
+
+  return count;
+}
+#endif /* EICU_USE_PPM */
 
 #endif /* HAL_USE_EICU */
\ No newline at end of file
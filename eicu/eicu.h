@@ -31,10 +31,130 @@
 /* Driver pre-compile time settings.                                         */
 /*===========================================================================*/
 
+/**
+ * @name    EICU configuration options
+ * @{
+ */
+/**
+ * @brief   Enables 64 bit timestamps.
+ * @details If set to @p TRUE the extended timestamps, widths and periods are
+ *          64 bit wide, else they are 32 bit wide.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(EICU_USE_64BIT_TIMESTAMPS) || defined(__DOXYGEN__)
+#define EICU_USE_64BIT_TIMESTAMPS           FALSE
+#endif
+
+/**
+ * @brief   Enables the capture queue and the @p eicuWaitCaptures() API.
+ * @details If set to @p TRUE the driver pushes each completed measurement
+ *          into a single-producer single-consumer queue that threads can
+ *          drain in batches.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(EICU_USE_QUEUE) || defined(__DOXYGEN__)
+#define EICU_USE_QUEUE                      FALSE
+#endif
+
+/**
+ * @brief   Enables the interrupt statistics and the @p eicuGetStats() API.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(EICU_USE_STATISTICS) || defined(__DOXYGEN__)
+#define EICU_USE_STATISTICS                 FALSE
+#endif
+
+/**
+ * @brief   Enables the per-channel measurement snapshots.
+ * @details If set to @p TRUE each published measurement is also stored in
+ *          a per-channel snapshot that any thread can read lock-free with
+ *          @p eicuGetSnapshot().
+ * @note    Every configured channel is then served by the capture
+ *          interrupt, also without a callback.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(EICU_USE_SNAPSHOTS) || defined(__DOXYGEN__)
+#define EICU_USE_SNAPSHOTS                  FALSE
+#endif
+
+/**
+ * @brief   Enables the per-channel aggregation of the width measurements.
+ * @details If set to @p TRUE the width callbacks can be batched, each one
+ *          reporting count, minimum, maximum, sum and sum of squares of the
+ *          widths measured since the previous one.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(EICU_USE_AGGREGATION) || defined(__DOXYGEN__)
+#define EICU_USE_AGGREGATION                FALSE
+#endif
+
+/**
+ * @brief   Enables the quadrature encoder input type.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(EICU_USE_ENCODER) || defined(__DOXYGEN__)
+#define EICU_USE_ENCODER                    FALSE
+#endif
+
+/**
+ * @brief   Enables the PPM frame decoder and the @p eicuReadPPM() API.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(EICU_USE_PPM) || defined(__DOXYGEN__)
+#define EICU_USE_PPM                        FALSE
+#endif
+
+/**
+ * @brief   Maximum number of channels in a PPM frame.
+ */
+#if !defined(EICU_PPM_MAX_CHANNELS) || defined(__DOXYGEN__)
+#define EICU_PPM_MAX_CHANNELS               16
+#endif
+
+/**
+ * @brief   Enables the per-channel deadband filter.
+ * @details If set to @p TRUE a channel can drop the measurements that did
+ *          not change by more than its deadband since the latest reported
+ *          one, they are then neither queued nor notified.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(EICU_USE_DEADBAND) || defined(__DOXYGEN__)
+#define EICU_USE_DEADBAND                   FALSE
+#endif
+
+/**
+ * @brief   Enables the event flags notification.
+ * @details If set to @p TRUE each published measurement also sets the bit
+ *          of its channel in a flags mask, broadcast once per interrupt on
+ *          the driver event source. Channels are then captured even without
+ *          callbacks.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(EICU_USE_EVENTS) || defined(__DOXYGEN__)
+#define EICU_USE_EVENTS                     FALSE
+#endif
+
+/**
+ * @brief   Enables the reference disciplined timebase.
+ * @details If set to @p TRUE a channel with a reference period measures
+ *          the actual timer clock, the conversion APIs then correct the
+ *          timer clock drift.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(EICU_USE_TIMEBASE) || defined(__DOXYGEN__)
+#define EICU_USE_TIMEBASE                   FALSE
+#endif
+/** @} */
+
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
 
+#if EICU_USE_PPM && ((EICU_PPM_MAX_CHANNELS < 1) ||                          \
+                     (EICU_PPM_MAX_CHANNELS > 254))
+#error "invalid EICU_PPM_MAX_CHANNELS value"
+#endif
+
 /*===========================================================================*/
 /* Driver data structures and types.                                         */
 /*===========================================================================*/
@@ -61,11 +181,243 @@ typedef enum {
   EICU_CHANNEL_4 = 3
 } eicuchannel_t;
 
+/**
+ * @brief   EICU extended timestamp type.
+ * @details Capture value extended with the count of timer overflows, also
+ *          used for widths and periods.
+ */
+#if EICU_USE_64BIT_TIMESTAMPS || defined(__DOXYGEN__)
+typedef uint64_t eicutstamp_t;
+#else
+typedef uint32_t eicutstamp_t;
+#endif
+
+/**
+ * @brief   EICU signed time interval type.
+ */
+#if EICU_USE_64BIT_TIMESTAMPS || defined(__DOXYGEN__)
+typedef int64_t eicuinterval_t;
+#else
+typedef int32_t eicuinterval_t;
+#endif
+
 /**
  * @brief   Type of a structure representing an EICU driver.
  */
 typedef struct EICUDriver EICUDriver;
 
+#if EICU_USE_STATISTICS || defined(__DOXYGEN__)
+/**
+ * @brief   EICU interrupt statistics.
+ */
+typedef struct {
+  /**
+   * @brief   Number of ISR passes.
+   */
+  uint32_t isr;
+  /**
+   * @brief   Number of ISR passes without any enabled source pending.
+   */
+  uint32_t spurious;
+  /**
+   * @brief   Number of captures served on each channel.
+   */
+  uint32_t captures[4];
+  /**
+   * @brief   Number of overcaptures on each channel.
+   * @details An overcapture means that at least one edge was captured and
+   *          overwritten before the ISR read it.
+   */
+  uint32_t overcaptures[4];
+} EICUStats;
+#endif
+
+#if EICU_USE_QUEUE || defined(__DOXYGEN__)
+/**
+ * @brief   EICU capture queue record.
+ */
+typedef struct {
+  /**
+   * @brief   Channel that produced the measurement.
+   */
+  eicuchannel_t channel;
+  /**
+   * @brief   Measured width.
+   */
+  eicutstamp_t width;
+  /**
+   * @brief   Measured period.
+   */
+  eicutstamp_t period;
+  /**
+   * @brief   Timestamp of the measurement start edge.
+   */
+  eicutstamp_t stamp;
+} EICUCapture;
+#endif
+
+#if EICU_USE_SNAPSHOTS || defined(__DOXYGEN__)
+/**
+ * @brief   EICU measurement snapshot.
+ */
+typedef struct {
+  /**
+   * @brief   Measured width.
+   */
+  eicutstamp_t width;
+  /**
+   * @brief   Measured period.
+   */
+  eicutstamp_t period;
+  /**
+   * @brief   Timestamp of the measurement start edge.
+   */
+  eicutstamp_t stamp;
+} EICUSnapshot;
+#endif
+
+#if EICU_USE_AGGREGATION || defined(__DOXYGEN__)
+/**
+ * @brief   EICU width aggregation over a window of measurements.
+ * @details All values are in ticks, the mean is @p sum / @p count and the
+ *          variance (@p sumsq - @p sum * mean) / @p count.
+ */
+typedef struct {
+  /**
+   * @brief   Number of measurements.
+   */
+  uint32_t count;
+  /**
+   * @brief   Smallest width.
+   */
+  eicutstamp_t min;
+  /**
+   * @brief   Largest width.
+   */
+  eicutstamp_t max;
+  /**
+   * @brief   Sum of the widths.
+   */
+  uint64_t sum;
+  /**
+   * @brief   Sum of the squared widths.
+   */
+  uint64_t sumsq;
+} EICUAggregate;
+#endif
+
+#if EICU_USE_DEADBAND || defined(__DOXYGEN__)
+/**
+ * @name    Deadband reference of an event
+ * @{
+ */
+#define EICU_DEADBAND_WIDTH                 0U
+#define EICU_DEADBAND_PERIOD                1U
+/** @} */
+
+/**
+ * @brief   EICU deadband reference.
+ * @details The latest measurement reported by an event of a channel.
+ */
+typedef struct {
+  /**
+   * @brief   Width of the latest reported measurement.
+   */
+  eicutstamp_t width;
+  /**
+   * @brief   Period of the latest reported measurement.
+   */
+  eicutstamp_t period;
+  /**
+   * @brief   Timestamp of the latest reported measurement.
+   */
+  eicutstamp_t stamp;
+  /**
+   * @brief   A measurement was reported since the driver was enabled.
+   */
+  bool valid;
+} EICUDeadband;
+#endif
+
+#if EICU_USE_TIMEBASE || defined(__DOXYGEN__)
+/**
+ * @brief   EICU reference disciplined timebase.
+ * @details Written by the ISR at each accepted reference period, readers
+ *          use the sequence counter to get a consistent pair of values.
+ */
+typedef struct {
+  /**
+   * @brief   Update sequence, odd while an update is in progress.
+   */
+  volatile uint32_t seq;
+  /**
+   * @brief   Reference periods accepted since the driver was started.
+   */
+  uint32_t count;
+  /**
+   * @brief   Measured timer clock in mHz.
+   */
+  uint64_t rate;
+  /**
+   * @brief   Nanoseconds per tick, 40.24 fixed point.
+   */
+  uint64_t nsq;
+} EICUTimebase;
+#endif
+
+#if EICU_USE_PPM || defined(__DOXYGEN__)
+/**
+ * @brief   Position of a PPM decoder out of sync.
+ */
+#define EICU_PPM_NOSYNC                     0xFFU
+
+/**
+ * @brief   EICU PPM frame decoder.
+ * @details The ISR fills the back buffer and swaps it with the front one
+ *          when a valid frame ends, readers use the sequence counter to
+ *          detect a swap during their copy.
+ */
+typedef struct {
+  /**
+   * @brief   Channel values in ticks, front and back buffers.
+   */
+  uint32_t values[2][EICU_PPM_MAX_CHANNELS];
+  /**
+   * @brief   Sync gap copied from the settings.
+   */
+  eicutstamp_t sync;
+  /**
+   * @brief   Minimum channel value copied from the settings.
+   */
+  eicutstamp_t min;
+  /**
+   * @brief   Maximum channel value copied from the settings.
+   */
+  eicutstamp_t max;
+  /**
+   * @brief   Expected channels per frame copied from the settings.
+   */
+  uint8_t channels;
+  /**
+   * @brief   Number of channels in each buffer.
+   */
+  uint8_t count[2];
+  /**
+   * @brief   Index of the buffer holding the latest complete frame.
+   */
+  volatile uint8_t front;
+  /**
+   * @brief   Next channel of the frame being decoded, or
+   *          @p EICU_PPM_NOSYNC.
+   */
+  uint8_t pos;
+  /**
+   * @brief   Number of complete frames decoded.
+   */
+  volatile uint32_t seq;
+} EICUPPM;
+#endif
+
 /**
  * @brief EICU notification callback type.
  *
@@ -105,13 +457,16 @@ typedef void (*eicucallback_t)(EICUDriver *eicup, eicuchannel_t channel);
 /**
  * @brief   Returns the width of the latest pulse.
  * @details The pulse width is defined as number of ticks between the start
- *          edge and the stop edge.
+ *          edge and the stop edge. In edge mode it is the number of ticks
+ *          since the previous edge.
+ * @note    In edge mode this is no longer the captured counter value, the
+ *          edge timestamp is returned by @p eicuGetTimestamp().
  * @note    This function is meant to be invoked from the width capture
- *          callback only.
+ *          callback only, other contexts use @p eicuGetSnapshot().
  *
  * @param[in] eicup     Pointer to the @p EICUDriver object
  * @param[in] channel   The timer channel that fired the interrupt.
- * @return              The number of ticks.
+ * @return              The number of ticks, overflows included.
  *
  * @special
  */
@@ -121,49 +476,475 @@ typedef void (*eicucallback_t)(EICUDriver *eicup, eicuchannel_t channel);
  * @brief   Returns the width of the latest cycle.
  * @details The cycle width is defined as number of ticks between a start
  *          edge and the next start edge.
+ * @note    This function is meant to be invoked from the capture callbacks
+ *          only.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @return              The number of ticks, overflows included.
+ *
+ * @special
+ */
+#define eicuGetPeriod(eicup, channel) eicu_lld_get_period((eicup), (channel))
+
+/**
+ * @brief   Returns the timestamp of the latest measurement.
+ * @details The timestamp is the extended counter value of the start edge of
+ *          the latest measured pulse or cycle, or of the edge itself in
+ *          edge mode.
+ * @note    This function is meant to be invoked from the capture callbacks
+ *          only.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @return              The timestamp in ticks since the driver was enabled.
+ *
+ * @special
+ */
+#define eicuGetTimestamp(eicup, channel)                                       \
+  eicu_lld_get_timestamp((eicup), (channel))
+
+/**
+ * @brief   Returns the frequency measured over the latest gate.
+ * @details Only meaningful in @p EICU_INPUT_FREQUENCY mode, the relative
+ *          resolution is one tick over the gate time whatever the input
+ *          frequency.
+ * @note    This function is meant to be invoked from the capture callback
+ *          only.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @return              The frequency in millihertz.
+ *
+ * @special
+ */
+#define eicuGetFrequency(eicup, channel)                                       \
+  eicu_lld_get_frequency((eicup), (channel))
+
+/**
+ * @brief   Returns the latest start to stop interval.
+ * @details Only meaningful in @p EICU_INPUT_INTERVAL mode, negative if the
+ *          stop edge came first.
+ * @note    This function is meant to be invoked from the capture callback
+ *          only.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The start channel of the pair.
+ * @return              The signed interval in ticks.
+ *
+ * @special
+ */
+#define eicuGetInterval(eicup, channel)                                        \
+  ((eicuinterval_t)eicu_lld_get_width((eicup), (channel)))
+
+/**
+ * @brief   Returns the average of the latest intervals.
+ * @details Only meaningful in @p EICU_INPUT_INTERVAL mode with
+ *          @p interval_avg set, the fractional bits give a resolution
+ *          better than one tick on jittered inputs.
+ * @note    This function is meant to be invoked from the capture callback
+ *          only.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The start channel of the pair.
+ * @return              The signed average interval in 1/256 ticks.
+ *
+ * @special
+ */
+#define eicuGetIntervalAverage(eicup, channel)                                 \
+  eicu_lld_get_interval_average((eicup), (channel))
+
+/**
+ * @brief   Returns the hall state sampled at the latest transition.
+ * @note    This function is meant to be invoked from the period callback
+ *          only.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @return              The hall inputs levels, channel 1 in bit 0.
+ *
+ * @special
+ */
+#define eicuGetHallState(eicup) eicu_lld_get_hall_state(eicup)
+
+#if EICU_USE_EVENTS || defined(__DOXYGEN__)
+/**
+ * @brief   Event flag of a channel with a new measurement.
+ *
+ * @param[in] channel   The timer channel.
+ */
+#define EICU_EVENT_CHANNEL(channel) ((eventflags_t)1 << (channel))
+
+/**
+ * @brief   Returns the event source of a driver.
+ * @details The flags broadcast on it are the @p EICU_EVENT_CHANNEL() bits
+ *          of the channels measured in the same interrupt, a listener gets
+ *          them all with a single wakeup.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @return              The pointer to the @p event_source_t.
+ *
+ * @special
+ */
+#define eicuGetEventSource(eicup) (&(eicup)->event)
+#endif
+
+#if EICU_USE_TIMEBASE || defined(__DOXYGEN__)
+/**
+ * @brief   Returns the number of reference periods accepted.
+ * @details Zero means the conversions still use the nominal timer clock.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @return              The accepted reference periods since the driver
+ *                      was started.
+ *
+ * @special
+ */
+#define eicuGetTimebaseCount(eicup) ((eicup)->timebase.count)
+#endif
+
+#if EICU_USE_ENCODER || defined(__DOXYGEN__)
+/**
+ * @brief   Returns the extended position of an encoder.
+ * @details The hardware count extended with its overflows and underflows,
+ *          it can be read from any context.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @return              The position in counts since the driver was enabled.
+ *
+ * @special
+ */
+#define eicuGetPosition(eicup) eicu_lld_get_position(eicup)
+
+/**
+ * @brief   Returns the velocity of an encoder.
+ * @details The velocity is estimated from the position change since the
+ *          previous call at speed, and from the time since the latest
+ *          position change when less than one count per call is seen.
+ * @note    Meant to be called periodically by a single thread, usually
+ *          the control loop.
+ * @note    The interval is measured in system ticks, so the estimate has
+ *          an error up to one tick over the interval. Calls should be at
+ *          least N system ticks apart for an error below 1/N, for example
+ *          100 ticks for 1%.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @return              The velocity in counts per second.
+ *
+ * @special
+ */
+#define eicuGetVelocity(eicup) eicu_lld_get_velocity(eicup)
+#endif
+
+#if EICU_USE_AGGREGATION || defined(__DOXYGEN__)
+/**
+ * @brief   Returns the aggregation of the latest closed window.
  * @note    This function is meant to be invoked from the width capture
  *          callback only.
  *
  * @param[in] eicup     Pointer to the @p EICUDriver object
- * @return              The number of ticks.
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @return              Pointer to the @p EICUAggregate of the window.
  *
  * @special
  */
-#define eicuGetPeriod(eicup) eicu_lld_get_period(eicup)
+#define eicuGetAggregate(eicup, channel)                                       \
+  eicu_lld_get_aggregate((eicup), (channel))
+#endif
 /** @} */
 
 /**
  * @name    Low Level driver helper macros
+ * @note    The capture phase is tracked in the state of each channel, the
+ *          driver state only follows the enable and disable operations.
  * @{
  */
+#if EICU_USE_QUEUE || defined(__DOXYGEN__)
+/**
+ * @brief   Common ISR code, pushes the latest measurement into the queue.
+ * @details The record is written before the write index is published, the
+ *          waiting thread is only woken once it has enough records. If the
+ *          queue is full the measurement is dropped.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] ch        The timer channel that fired the interrupt.
+ *
+ * @notapi
+ */
+#define _eicu_isr_queue_capture(eicup, ch) {                                   \
+  size_t wr = (eicup)->qwr;                                                    \
+  if (((eicup)->qbuf != NULL) && (wr - (eicup)->qrd < (eicup)->qsize)) {      \
+    EICUCapture *cp = &(eicup)->qbuf[wr & ((eicup)->qsize - 1)];               \
+    cp->channel = (ch);                                                        \
+    cp->width   = (eicup)->channels[(ch)].width;                               \
+    cp->period  = (eicup)->channels[(ch)].period;                              \
+    cp->stamp   = (eicup)->channels[(ch)].stamp;                               \
+    __DMB();                                                                   \
+    (eicup)->qwr = ++wr;                                                       \
+    if (((eicup)->thread != NULL) && (wr - (eicup)->qrd >= (eicup)->qwanted)) {\
+      osalSysLockFromISR();                                                    \
+      osalThreadResumeI(&(eicup)->thread, MSG_OK);                             \
+      osalSysUnlockFromISR();                                                  \
+    }                                                                          \
+  }                                                                            \
+}
+#else
+#define _eicu_isr_queue_capture(eicup, ch)
+#endif
+
+#if EICU_USE_SNAPSHOTS || defined(__DOXYGEN__)
+/**
+ * @brief   Common ISR code, stores the latest measurement in the snapshot.
+ * @details The sequence counter is odd while the snapshot is updated.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] ch        The timer channel that fired the interrupt.
+ *
+ * @notapi
+ */
+#define _eicu_isr_snapshot(eicup, ch) {                                        \
+  EICUChannel *snchp = &(eicup)->channels[(ch)];                               \
+  snchp->seq++;                                                                \
+  __DMB();                                                                     \
+  snchp->snapshot.width  = snchp->width;                                       \
+  snchp->snapshot.period = snchp->period;                                      \
+  snchp->snapshot.stamp  = snchp->stamp;                                       \
+  __DMB();                                                                     \
+  snchp->seq++;                                                                \
+}
+#else
+#define _eicu_isr_snapshot(eicup, ch)
+#endif
+
+#if EICU_USE_AGGREGATION || defined(__DOXYGEN__)
+/**
+ * @brief   Common ISR code, feeds the latest width to the aggregation.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @return              The width callback is due.
+ *
+ * @notapi
+ */
+#define _eicu_isr_aggregate(eicup, channel)                                    \
+  _eicu_aggregate((eicup), (channel))
+#else
+#define _eicu_isr_aggregate(eicup, channel) true
+#endif
+
+#if EICU_USE_EVENTS || defined(__DOXYGEN__)
+/**
+ * @brief   Common ISR code, notifies a new measurement.
+ * @details The event flag is only collected, it is broadcast at the end of
+ *          the interrupt by @p _eicu_isr_broadcast().
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @param[in] cb        The callback resolved for the event.
+ *
+ * @notapi
+ */
+#define _eicu_isr_notify(eicup, channel, cb) {                                 \
+  (eicup)->eflags |= EICU_EVENT_CHANNEL(channel);                              \
+  if ((cb) != NULL)                                                            \
+    (cb)((eicup), (channel));                                                  \
+}
+
+/**
+ * @brief   Common ISR code, broadcasts the event flags of the interrupt.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ *
+ * @notapi
+ */
+#define _eicu_isr_broadcast(eicup) {                                           \
+  if ((eicup)->eflags != 0) {                                                  \
+    osalSysLockFromISR();                                                      \
+    osalEventBroadcastFlagsI(&(eicup)->event, (eicup)->eflags);                \
+    osalSysUnlockFromISR();                                                    \
+    (eicup)->eflags = 0;                                                       \
+  }                                                                            \
+}
+#else
+#define _eicu_isr_notify(eicup, channel, cb) {                                 \
+  if ((cb) != NULL)                                                            \
+    (cb)((eicup), (channel));                                                  \
+}
+#define _eicu_isr_broadcast(eicup)
+#endif
+
+/**
+ * @brief   Common ISR code, checks if the latest measurement is reported.
+ * @details Width and period events of the same channel, as in PWM mode,
+ *          each have their own reference, so a change reported by one is
+ *          still reported by the other.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @param[in] ev        @p EICU_DEADBAND_WIDTH or @p EICU_DEADBAND_PERIOD.
+ *
+ * @notapi
+ */
+#if EICU_USE_DEADBAND || defined(__DOXYGEN__)
+#define _eicu_isr_deadband(eicup, channel, ev)                                 \
+  _eicu_deadband((eicup), (channel), (ev))
+#else
+#define _eicu_isr_deadband(eicup, channel, ev) true
+#endif
+
+/**
+ * @brief   Common ISR code, publishes the latest measurement.
+ * @details The snapshot always gets the measurement, the queue and the
+ *          notification only if it passes the deadband of the period
+ *          events.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @param[in] cb        The callback resolved for the event.
+ *
+ * @notapi
+ */
+#define _eicu_isr_publish(eicup, channel, cb) {                                \
+  _eicu_isr_snapshot((eicup), (channel));                                      \
+  if (_eicu_isr_deadband((eicup), (channel), EICU_DEADBAND_PERIOD)) {         \
+    _eicu_isr_queue_capture((eicup), (channel));                               \
+    _eicu_isr_notify((eicup), (channel), (cb))                                 \
+  }                                                                            \
+}
+
+/**
+ * @brief   Common ISR code, publishes the latest width measurement.
+ * @details The aggregation gets every measurement, the queue the ones
+ *          passing the deadband of the width events, the callback and the
+ *          event flag the ones passing it and closing an aggregation
+ *          window.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @param[in] cb        The callback resolved for the event.
+ *
+ * @notapi
+ */
+#define _eicu_isr_publish_width(eicup, channel, cb) {                          \
+  bool reported;                                                               \
+  _eicu_isr_snapshot((eicup), (channel));                                      \
+  reported = _eicu_isr_deadband((eicup), (channel), EICU_DEADBAND_WIDTH);      \
+  if (reported) {                                                              \
+    _eicu_isr_queue_capture((eicup), (channel));                               \
+  }                                                                            \
+  if ((((cb) != NULL) || EICU_USE_EVENTS) &&                                   \
+      _eicu_isr_aggregate((eicup), (channel)) && reported)                     \
+    _eicu_isr_notify((eicup), (channel), (cb))                                 \
+}
+
 /**
  * @brief   Common ISR code, EICU PWM width event.
+ * @details The width is counted from the counter reset done by the period
+ *          edge, overflows in between are accounted by the epoch. The
+ *          deadband only filters the report, the aggregation gets every
+ *          width.
  *
  * @param[in] eicup     Pointer to the @p EICUDriver object
  * @param[in] channel   The timer channel that fired the interrupt.
+ * @param[in] cb        The callback resolved for the event.
+ * @param[in] sr        The status register snapshot of the interrupt.
  *
  * @notapi
  */
-#define _eicu_isr_invoke_pwm_width_cb(eicup, channel) {                        \
-  if ((eicup)->state != EICU_WAITING) {                                        \
-    (eicup)->state = EICU_IDLE;                                                \
-    (eicup)->config->iccfgp[channel]->width_cb((eicup), (channel));            \
+#define _eicu_isr_invoke_pwm_width_cb(eicup, channel, cb, sr) {                \
+  EICUChannel *chp = &(eicup)->channels[(channel)];                            \
+  if (chp->state != EICU_WAITING) {                                            \
+    eicucnt_t capture = eicu_lld_get_compare((eicup), (channel));              \
+    bool reported;                                                             \
+    chp->state = EICU_IDLE;                                                    \
+    chp->width = eicu_lld_extend((eicup), capture, (sr)) + 1;                  \
+    chp->stamp = chp->last;                                                    \
+    _eicu_isr_snapshot((eicup), (channel));                                    \
+    reported = _eicu_isr_deadband((eicup), (channel), EICU_DEADBAND_WIDTH);    \
+    if ((((cb) != NULL) || EICU_USE_EVENTS) &&                                 \
+        _eicu_isr_aggregate((eicup), (channel)) && reported)                   \
+      _eicu_isr_notify((eicup), (channel), (cb))                               \
   }                                                                            \
 }
 
 /**
  * @brief   Common ISR code, EICU PWM period event.
+ * @details The period edge resets the counter, so the epoch restarts from
+ *          zero. An overflow pending in the same interrupt that happened
+ *          before the capture is consumed here and not counted again.
  *
  * @param[in] eicup     Pointer to the @p EICUDriver object
  * @param[in] channel   The timer channel that fired the interrupt.
+ * @param[in] cb        The callback resolved for the event.
+ * @param[in] sr        The status register snapshot of the interrupt.
  *
  * @notapi
  */
-#define _eicu_isr_invoke_pwm_period_cb(eicup, channel) {                       \
-  eicustate_t previous_state = (eicup)->state;                                 \
-  (eicup)->state = EICU_ACTIVE;                                                \
+#define _eicu_isr_invoke_pwm_period_cb(eicup, channel, cb, sr) {               \
+  EICUChannel *chp = &(eicup)->channels[(channel)];                            \
+  eicucnt_t capture = (eicucnt_t)*((eicup)->pccrp);                            \
+  eicustate_t previous_state = chp->state;                                     \
+  chp->state = EICU_ACTIVE;                                                    \
+  chp->period = eicu_lld_extend((eicup), capture, (sr)) + 1;                   \
+  chp->stamp  = chp->last;                                                     \
+  chp->last  += chp->period;                                                   \
+  (eicup)->epoch = eicu_lld_overflow_before((eicup), (capture), (sr)) ?        \
+                   0 - eicu_lld_get_epoch_increment(eicup) : 0;                \
   if (previous_state != EICU_WAITING)                                          \
-    (eicup)->config->period_cb((eicup), (channel));                            \
+    _eicu_isr_publish((eicup), (channel), (cb))                                \
+}
+
+/**
+ * @brief   Common ISR code, EICU pulse start edge.
+ * @details A start edge completes the cycle begun by the previous one, in
+ *          multi-channel PWM mode it is published as a period event.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @param[in] pcb       The period callback, @p NULL if not used.
+ * @param[in] tstamp    Extended timestamp of the start edge.
+ *
+ * @notapi
+ */
+#define _eicu_isr_pulse_start(eicup, channel, pcb, tstamp) {                   \
+  EICUChannel *chp = &(eicup)->channels[(channel)];                            \
+  eicustate_t previous_state = chp->state;                                     \
+  chp->state  = EICU_ACTIVE;                                                   \
+  chp->prev   = chp->last;                                                     \
+  chp->period = (tstamp) - chp->last;                                          \
+  chp->last   = (tstamp);                                                      \
+  if (((eicup)->input_type == EICU_INPUT_PWM_MULTI) &&                         \
+      (previous_state != EICU_WAITING)) {                                      \
+    chp->stamp = chp->prev;                                                    \
+    _eicu_isr_publish((eicup), (channel), (pcb))                               \
+  }                                                                            \
+}
+
+/**
+ * @brief   Common ISR code, EICU pulse stop edge.
+ * @details A stop edge older than the latest start edge, which can happen
+ *          when both edges are captured on separate channels and served in
+ *          the same interrupt, ends the pulse started by the previous start
+ *          edge.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @param[in] cb        The callback resolved for the event.
+ * @param[in] tstamp    Extended timestamp of the stop edge.
+ *
+ * @notapi
+ */
+#define _eicu_isr_invoke_pulse_stop_cb(eicup, channel, cb, tstamp) {           \
+  EICUChannel *chp = &(eicup)->channels[(channel)];                            \
+  if (chp->state == EICU_ACTIVE) {                                             \
+    eicutstamp_t start = chp->last;                                            \
+    if (eicu_lld_is_before((tstamp), start))                                   \
+      start = chp->prev;                                                       \
+    else                                                                       \
+      chp->state = EICU_READY;                                                 \
+    chp->width = (tstamp) - start;                                             \
+    chp->stamp = start;                                                        \
+    _eicu_isr_publish_width((eicup), (channel), (cb))                          \
+  }                                                                            \
 }
 
 /**
@@ -175,43 +956,224 @@ typedef void (*eicucallback_t)(EICUDriver *eicup, eicuchannel_t channel);
  * 
  * @param[in] eicup     Pointer to the @p EICUDriver object
  * @param[in] channel   The timer channel that fired the interrupt.
+ * @param[in] cb        The callback resolved for the event.
+ * @param[in] pcb       The period callback, @p NULL if not used.
+ * @param[in] sr        The status register snapshot of the interrupt.
  *
  * @notapi
  */
-#define _eicu_isr_invoke_pulse_width_cb(eicup, channel) {                      \
-  if ((eicup)->state == EICU_ACTIVE) {                                         \
-    (eicup)->state = EICU_READY;                                               \
-    eicu_lld_invert_polarity((eicup), (channel));                              \
-    (eicup)->config->iccfgp[(channel)]->width_cb((eicup), (channel));          \
-  } else {                                                                     \
-    (eicup)->state = EICU_ACTIVE;                                              \
-    (eicup)->last_count[(channel)] = eicu_lld_get_compare((eicup), (channel)); \
-    eicu_lld_invert_polarity((eicup), (channel));                              \
-  }                                                                            \
+#define _eicu_isr_invoke_pulse_width_cb(eicup, channel, cb, pcb, sr) {         \
+  eicucnt_t capture = eicu_lld_get_compare((eicup), (channel));                \
+  eicutstamp_t stamp = eicu_lld_extend((eicup), capture, (sr));                \
+  eicu_lld_invert_polarity((eicup), (channel));                                \
+  if ((eicup)->channels[(channel)].state == EICU_ACTIVE)                       \
+    _eicu_isr_invoke_pulse_stop_cb((eicup), (channel), (cb), stamp)            \
+  else                                                                         \
+    _eicu_isr_pulse_start((eicup), (channel), (pcb), stamp)                    \
 }
 
 /**
  * @brief   Common ISR code, EICU Edge detect event.
+ * @details Width and period are both the time since the previous edge,
+ *          divided by the input prescaler ratio. The first edge after
+ *          enable or after a timeout has no previous edge, it is only
+ *          recorded.
  *
  * @param[in] eicup     Pointer to the @p EICUDriver object
  * @param[in] channel   The timer channel that fired the interrupt.
+ * @param[in] cb        The callback resolved for the event.
+ * @param[in] sr        The status register snapshot of the interrupt.
  *
  * @notapi
  */
-#define _eicu_isr_invoke_edge_detect_cb(eicup, channel) {                      \
-  (eicup)->state = EICU_READY;                                                 \
-  (eicup)->config->iccfgp[(channel)]->width_cb((eicup), (channel));            \
+#define _eicu_isr_invoke_edge_detect_cb(eicup, channel, cb, sr) {              \
+  EICUChannel *chp = &(eicup)->channels[(channel)];                            \
+  eicucnt_t capture = eicu_lld_get_compare((eicup), (channel));                \
+  eicutstamp_t stamp = eicu_lld_extend((eicup), capture, (sr));                \
+  if (chp->state == EICU_WAITING) {                                            \
+    chp->state = EICU_READY;                                                   \
+    chp->last  = stamp;                                                        \
+  }                                                                            \
+  else {                                                                       \
+    chp->stamp  = stamp;                                                       \
+    chp->period = (stamp - chp->last) >> chp->psc;                             \
+    chp->width  = chp->period;                                                 \
+    chp->last   = stamp;                                                       \
+    _eicu_isr_publish_width((eicup), (channel), (cb))                          \
+  }                                                                            \
 }
 
+/**
+ * @brief   Common ISR code, EICU frequency counter edge.
+ * @details The edge closing a gate opens the next one, so no input cycle
+ *          is lost between gates. Width is the gate span in ticks, period
+ *          the mean input period.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @param[in] cb        The callback resolved for the event.
+ * @param[in] sr        The status register snapshot of the interrupt.
+ *
+ * @notapi
+ */
+#define _eicu_isr_invoke_frequency_cb(eicup, channel, cb, sr) {                \
+  EICUChannel *chp = &(eicup)->channels[(channel)];                            \
+  eicucnt_t capture = eicu_lld_get_compare((eicup), (channel));                \
+  eicutstamp_t stamp = eicu_lld_extend((eicup), capture, (sr));                \
+  if (chp->state == EICU_WAITING) {                                            \
+    chp->state = EICU_ACTIVE;                                                  \
+    chp->last  = stamp;                                                        \
+    chp->edges = 0;                                                            \
+  }                                                                            \
+  else {                                                                       \
+    chp->edges += 1U << chp->psc;                                              \
+    if (stamp - chp->last >= chp->gate) {                                      \
+      chp->width  = stamp - chp->last;                                         \
+      chp->period = chp->width / chp->edges;                                   \
+      chp->count  = chp->edges;                                                \
+      chp->stamp  = chp->last;                                                 \
+      chp->last   = stamp;                                                     \
+      chp->edges  = 0;                                                         \
+      _eicu_isr_publish((eicup), (channel), (cb))                              \
+    }                                                                          \
+  }                                                                            \
+}
+
+/**
+ * @brief   Common ISR code, EICU time interval edge.
+ * @details The pair is complete once both its start and its stop edges
+ *          were captured, whatever their order. A repeated edge of the same
+ *          side replaces the previous one. Width is the signed interval,
+ *          period the time since the start edge of the previous pair.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The start channel of the pair.
+ * @param[in] cb        The callback resolved for the event.
+ * @param[in] side      Side of the edge, 1 for start and 2 for stop.
+ * @param[in] tstamp    Extended timestamp of the edge.
+ *
+ * @notapi
+ */
+#define _eicu_isr_invoke_interval_cb(eicup, channel, cb, side, tstamp) {       \
+  EICUChannel *chp = &(eicup)->channels[(channel)];                            \
+  uint32_t navg = chp->navg;                                                   \
+  if ((side) == 1U)                                                            \
+    chp->last = (tstamp);                                                      \
+  else                                                                         \
+    chp->prev = (tstamp);                                                      \
+  chp->pending |= (side);                                                      \
+  if (chp->pending == 3U) {                                                    \
+    chp->pending = 0;                                                          \
+    chp->width   = chp->prev - chp->last;                                      \
+    chp->period  = (chp->state == EICU_WAITING) ? 0 : chp->last - chp->stamp;  \
+    chp->stamp   = chp->last;                                                  \
+    chp->state   = EICU_ACTIVE;                                                \
+    if (navg > 1U) {                                                           \
+      chp->isum += (eicuinterval_t)chp->width;                                 \
+      if (++chp->icount >= navg) {                                             \
+        chp->iavg   = (eicuinterval_t)((chp->isum * 256) / (int64_t)navg);     \
+        chp->isum   = 0;                                                       \
+        chp->icount = 0;                                                       \
+        _eicu_isr_publish((eicup), (channel), (cb))                            \
+      }                                                                        \
+    }                                                                          \
+    else {                                                                     \
+      chp->iavg = (eicuinterval_t)chp->width * 256;                            \
+      _eicu_isr_publish((eicup), (channel), (cb))                              \
+    }                                                                          \
+  }                                                                            \
+}
+
+#if EICU_USE_TIMEBASE || defined(__DOXYGEN__)
+/**
+ * @brief   Common ISR code, EICU timebase reference edge.
+ * @details Width and period are the reference period in ticks, it is only
+ *          published if the timebase accepted it.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @param[in] cb        The callback resolved for the event.
+ * @param[in] sr        The status register snapshot of the interrupt.
+ *
+ * @notapi
+ */
+#define _eicu_isr_invoke_reference_cb(eicup, channel, cb, sr) {                \
+  EICUChannel *chp = &(eicup)->channels[(channel)];                            \
+  eicucnt_t capture = eicu_lld_get_compare((eicup), (channel));                \
+  eicutstamp_t stamp = eicu_lld_extend((eicup), capture, (sr));                \
+  if (chp->state == EICU_WAITING)                                              \
+    chp->state = EICU_ACTIVE;                                                  \
+  else {                                                                       \
+    chp->width  = stamp - chp->last;                                           \
+    chp->period = chp->width;                                                  \
+    chp->stamp  = chp->last;                                                   \
+    if (_eicu_timebase_update((eicup), (channel)))                             \
+      _eicu_isr_publish((eicup), (channel), (cb))                              \
+  }                                                                            \
+  chp->last = stamp;                                                           \
+}
+#endif
+
+#if EICU_USE_PPM || defined(__DOXYGEN__)
+/**
+ * @brief   Common ISR code, EICU PPM frame decoder edge.
+ * @details The time between two edges is a channel value, a gap of at
+ *          least the sync time ends the frame. A frame is published only if
+ *          all its channel values are in range and, if configured, their
+ *          number matches. Width is the sync gap, period the frame length.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @param[in] cb        The callback resolved for the event.
+ * @param[in] sr        The status register snapshot of the interrupt.
+ *
+ * @notapi
+ */
+#define _eicu_isr_invoke_ppm_cb(eicup, channel, cb, sr) {                      \
+  EICUChannel *chp = &(eicup)->channels[(channel)];                            \
+  EICUPPM *ppmp = &(eicup)->ppm;                                               \
+  eicucnt_t capture = eicu_lld_get_compare((eicup), (channel));                \
+  eicutstamp_t stamp = eicu_lld_extend((eicup), capture, (sr));                \
+  eicutstamp_t delta = stamp - chp->last;                                      \
+  uint8_t back = ppmp->front ^ 1U;                                             \
+  if (chp->state == EICU_WAITING)                                              \
+    chp->state = EICU_ACTIVE;                                                  \
+  else if (delta >= ppmp->sync) {                                              \
+    if ((ppmp->pos != EICU_PPM_NOSYNC) && (ppmp->pos > 0) &&                   \
+        ((ppmp->channels == 0) || (ppmp->pos == ppmp->channels))) {            \
+      ppmp->count[back] = ppmp->pos;                                           \
+      ppmp->front = back;                                                      \
+      __DMB();                                                                 \
+      ppmp->seq++;                                                             \
+      chp->width  = delta;                                                     \
+      chp->period = stamp - chp->prev;                                         \
+      chp->stamp  = chp->prev;                                                 \
+      _eicu_isr_publish((eicup), (channel), (cb))                              \
+    }                                                                          \
+    ppmp->pos = 0;                                                             \
+    chp->prev = stamp;                                                         \
+  }                                                                            \
+  else if ((ppmp->pos < EICU_PPM_MAX_CHANNELS) &&                              \
+           (delta >= ppmp->min) && (delta <= ppmp->max))                       \
+    ppmp->values[back][ppmp->pos++] = (uint32_t)delta;                         \
+  else                                                                         \
+    ppmp->pos = EICU_PPM_NOSYNC;                                               \
+  chp->last = stamp;                                                           \
+}
+#endif
+
 /**
  * @brief   Common ISR code, EICU timer overflow event.
+ * @note    Must run after the capture events of the same interrupt.
  *
  * @param[in] eicup      Pointer to the @p EICUDriver object
  *
  * @notapi
  */
-#define _eicu_isr_invoke_overflow_cb(icup) {                                   \
-  (eicup)->config->overflow_cb(eicup, 0);                                      \
+#define _eicu_isr_invoke_overflow_cb(eicup) {                                  \
+  (eicup)->epoch += eicu_lld_get_epoch_increment(eicup);                      \
+  if ((eicup)->overflow_cb != NULL)                                            \
+    (eicup)->overflow_cb((eicup), 0);                                          \
 }
 /** @} */
 
@@ -227,7 +1189,38 @@ extern "C" {
   void eicuStart(EICUDriver *eicup, const EICUConfig *config);
   void eicuStop(EICUDriver *eicup);
   void eicuEnable(EICUDriver *eicup);
+  void eicuEnableSynchronized(EICUDriver *masterp, EICUDriver *const *slavesp,
+                              size_t n);
   void eicuDisable(EICUDriver *eicup);
+#if EICU_USE_STATISTICS
+  void eicuGetStats(EICUDriver *eicup, EICUStats *statsp);
+#endif
+#if EICU_USE_QUEUE
+  size_t eicuWaitCaptures(EICUDriver *eicup, EICUCapture *buf, size_t n,
+                          systime_t timeout);
+#endif
+#if EICU_USE_SNAPSHOTS
+  uint32_t eicuGetSnapshot(EICUDriver *eicup, eicuchannel_t channel,
+                           EICUSnapshot *snp);
+#endif
+#if EICU_USE_AGGREGATION
+  bool _eicu_aggregate(EICUDriver *eicup, eicuchannel_t channel);
+#endif
+#if EICU_USE_DEADBAND
+  bool _eicu_deadband(EICUDriver *eicup, eicuchannel_t channel,
+                      uint32_t ev);
+#endif
+#if EICU_USE_TIMEBASE
+  bool _eicu_timebase_update(EICUDriver *eicup, eicuchannel_t channel);
+  uint64_t eicuGetClock(EICUDriver *eicup);
+  uint64_t eicuTicksToNs(EICUDriver *eicup, eicutstamp_t ticks);
+  uint64_t eicuTicksToMicroHz(EICUDriver *eicup, eicutstamp_t ticks,
+                              uint32_t cycles);
+#endif
+#if EICU_USE_PPM
+  size_t eicuReadPPM(EICUDriver *eicup, uint32_t *values, size_t n,
+                     uint32_t *seqp);
+#endif
 #ifdef __cplusplus
 }
 #endif
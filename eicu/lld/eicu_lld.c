@@ -42,6 +42,62 @@
 /* Driver local definitions.                                                 */
 /*===========================================================================*/
 
+/**
+ * @brief   Input type of a timer with a generic interrupt handler.
+ */
+#define EICU_LLD_INPUT_ANY                  ((eicuinput_t)0xFF)
+
+/**
+ * @name    Interrupt sources served by an IRQ vector
+ * @{
+ */
+#define EICU_LLD_SRC_CC                     (STM32_TIM_SR_CC1IF |             \
+                                             STM32_TIM_SR_CC2IF |             \
+                                             STM32_TIM_SR_CC3IF |             \
+                                             STM32_TIM_SR_CC4IF)
+#define EICU_LLD_SRC_UP                     STM32_TIM_SR_UIF
+#define EICU_LLD_SRC_ALL                    (EICU_LLD_SRC_CC | EICU_LLD_SRC_UP)
+/** @} */
+
+/**
+ * @brief   Inlining of the handler paths specialized per timer.
+ */
+#if !defined(EICU_LLD_FORCE_INLINE) || defined(__DOXYGEN__)
+#define EICU_LLD_FORCE_INLINE              inline __attribute__((always_inline))
+#endif
+
+/**
+ * @brief   At least one enabled timer has a generic interrupt handler.
+ */
+#if (STM32_EICU_USE_TIM1 && !defined(STM32_EICU_TIM1_INPUT_TYPE)) ||          \
+    (STM32_EICU_USE_TIM2 && !defined(STM32_EICU_TIM2_INPUT_TYPE)) ||          \
+    (STM32_EICU_USE_TIM3 && !defined(STM32_EICU_TIM3_INPUT_TYPE)) ||          \
+    (STM32_EICU_USE_TIM4 && !defined(STM32_EICU_TIM4_INPUT_TYPE)) ||          \
+    (STM32_EICU_USE_TIM5 && !defined(STM32_EICU_TIM5_INPUT_TYPE)) ||          \
+    (STM32_EICU_USE_TIM8 && !defined(STM32_EICU_TIM8_INPUT_TYPE)) ||          \
+    (STM32_EICU_USE_TIM9 && !defined(STM32_EICU_TIM9_INPUT_TYPE)) ||          \
+    (STM32_EICU_USE_TIM12 && !defined(STM32_EICU_TIM12_INPUT_TYPE))
+#define EICU_LLD_HAS_GENERIC_ISR            TRUE
+#else
+#define EICU_LLD_HAS_GENERIC_ISR            FALSE
+#endif
+
+/**
+ * @brief   At least one enabled timer has a specialized interrupt handler.
+ */
+#if (STM32_EICU_USE_TIM1 && defined(STM32_EICU_TIM1_INPUT_TYPE)) ||           \
+    (STM32_EICU_USE_TIM2 && defined(STM32_EICU_TIM2_INPUT_TYPE)) ||           \
+    (STM32_EICU_USE_TIM3 && defined(STM32_EICU_TIM3_INPUT_TYPE)) ||           \
+    (STM32_EICU_USE_TIM4 && defined(STM32_EICU_TIM4_INPUT_TYPE)) ||           \
+    (STM32_EICU_USE_TIM5 && defined(STM32_EICU_TIM5_INPUT_TYPE)) ||           \
+    (STM32_EICU_USE_TIM8 && defined(STM32_EICU_TIM8_INPUT_TYPE)) ||           \
+    (STM32_EICU_USE_TIM9 && defined(STM32_EICU_TIM9_INPUT_TYPE)) ||           \
+    (STM32_EICU_USE_TIM12 && defined(STM32_EICU_TIM12_INPUT_TYPE))
+#define EICU_LLD_HAS_FIXED_ISR              TRUE
+#else
+#define EICU_LLD_HAS_FIXED_ISR              FALSE
+#endif
+
 /*===========================================================================*/
 /* Driver exported variables.                                                */
 /*===========================================================================*/
@@ -117,57 +173,869 @@ EICUDriver EICUD12;
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 /**
- * @brief   Shared IRQ handler.
+ * @brief   Checks if the captures of a channel must be served by the ISR.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] channel   The timer channel to check.
+ * @return              The channel needs its capture interrupt.
+ */
+static bool eicu_lld_is_served(EICUDriver *eicup, eicuchannel_t channel)
+{
+  const EICU_IC_Settings *icp = eicup->config->iccfgp[channel];
+
+  /* Encoders count in hardware, there is nothing to capture.*/
+  if ((icp == NULL) || (eicup->config->input_type == EICU_INPUT_ENCODER))
+    return false;
+#if EICU_USE_TIMEBASE
+  /* The reference periods discipline the timebase, callback or not.*/
+  if (icp->ref_period != 0)
+    return true;
+#endif
+#if EICU_USE_EVENTS || EICU_USE_SNAPSHOTS
+  /* Event flags and snapshots are read without any callback.*/
+  return true;
+#endif
+#if EICU_USE_QUEUE
+  if (eicup->config->queue_buffer != NULL)
+    return true;
+#endif
+  if ((eicup->config->input_type == EICU_INPUT_PWM_MULTI) &&
+      (eicup->config->period_cb != NULL))
+    return true;
+  /* Decoded frames are also read by polling.*/
+  if (eicup->config->input_type == EICU_INPUT_PPM)
+    return true;
+  return icp->width_cb != NULL;
+}
+
+/**
+ * @brief   Checks if a configuration captures its edges with the pulse
+ *          engines.
+ *
+ * @param[in] cfgp      Pointer to the @p EICUConfig object
+ * @return              Pulse or multi-channel PWM input.
+ */
+static bool eicu_lld_uses_pulse(const EICUConfig *cfgp)
+{
+  return (cfgp->input_type == EICU_INPUT_PULSE) ||
+         (cfgp->input_type == EICU_INPUT_PWM_MULTI);
+}
+
+#if STM32_EICU_USE_DMA || defined(__DOXYGEN__)
+/**
+ * @brief   Shared DMA capture IRQ handler.
+ * @details Hands the completed half of the circular buffer to the channel
+ *          callback, the DMA keeps filling the other half meanwhile.
+ *
+ * @param[in] dmap      Pointer to the @p EICUDMAChannel object
+ * @param[in] flags     Pre-shifted content of the ISR register
+ */
+static void eicu_lld_serve_dma_interrupt(EICUDMAChannel *dmap, uint32_t flags)
+{
+  size_t half = dmap->half;
+
+  /* DMA errors handling.*/
+  if ((flags & (STM32_DMA_ISR_TEIF | STM32_DMA_ISR_DMEIF)) != 0) {
+    STM32_EICU_DMA_ERROR_HOOK(dmap->eicup);
+  }
+
+  /* Both flags can be pending if the interrupt was delayed, the first half
+     is then the older one.*/
+  if ((flags & STM32_DMA_ISR_HTIF) != 0)
+    dmap->cb(dmap->eicup, dmap->channel, &dmap->buffer[0], half);
+  if ((flags & STM32_DMA_ISR_TCIF) != 0)
+    dmap->cb(dmap->eicup, dmap->channel, &dmap->buffer[half], half);
+}
+
+/**
+ * @brief   Allocates the DMA streams of the channels in DMA capture mode.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ */
+static void eicu_lld_dma_allocate(EICUDriver *eicup)
+{
+  const EICU_IC_Settings *icp;
+  size_t n;
+  bool b;
+
+  for (n = 0; n < 4; n++) {
+    icp = eicup->config->iccfgp[n];
+    eicup->dma[n].eicup   = eicup;
+    eicup->dma[n].channel = (eicuchannel_t)n;
+    eicup->dma[n].dmastp  = NULL;
+
+    if ((icp == NULL) || (icp->dma_buffer == NULL))
+      continue;
+
+    osalDbgAssert(eicup->config->input_type == EICU_INPUT_EDGE,
+                  "DMA capture only in edge mode");
+    osalDbgAssert((icp->dma_depth >= 2) && ((icp->dma_depth & 1) == 0) &&
+                  (icp->dma_cb != NULL), "invalid DMA buffer");
+
+    eicup->dma[n].buffer = icp->dma_buffer;
+    eicup->dma[n].half   = icp->dma_depth / 2;
+    eicup->dma[n].cb     = icp->dma_cb;
+    eicup->dma[n].dmastp = STM32_DMA_STREAM(icp->dma_stream);
+    b = dmaStreamAllocate(eicup->dma[n].dmastp,
+                          STM32_EICU_DMA_IRQ_PRIORITY,
+                          (stm32_dmaisr_t)eicu_lld_serve_dma_interrupt,
+                          (void *)&eicup->dma[n]);
+    osalDbgAssert(!b, "stream already allocated");
+    dmaStreamSetPeripheral(eicup->dma[n].dmastp, &eicup->tim->CCR[n]);
+  }
+}
+
+/**
+ * @brief   Releases the DMA streams allocated by the driver.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ */
+static void eicu_lld_dma_release(EICUDriver *eicup)
+{
+  size_t n;
+
+  for (n = 0; n < 4; n++) {
+    if (eicup->dma[n].dmastp != NULL) {
+      dmaStreamRelease(eicup->dma[n].dmastp);
+      eicup->dma[n].dmastp = NULL;
+    }
+  }
+}
+#endif /* STM32_EICU_USE_DMA */
+
+/**
+ * @brief   Capture service routine, PWM width.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] dp        Dispatch entry of the capture flag
+ * @param[in] sr        The status register snapshot of the interrupt
+ */
+static void eicu_lld_serve_pwm_width(EICUDriver *eicup,
+                                     const EICUDispatch *dp, uint32_t sr)
+{
+  _eicu_isr_invoke_pwm_width_cb(eicup, dp->channel, dp->cb, sr);
+}
+
+/**
+ * @brief   Capture service routine, PWM period.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] dp        Dispatch entry of the capture flag
+ * @param[in] sr        The status register snapshot of the interrupt
+ */
+static void eicu_lld_serve_pwm_period(EICUDriver *eicup,
+                                      const EICUDispatch *dp, uint32_t sr)
+{
+  _eicu_isr_invoke_pwm_period_cb(eicup, dp->channel, dp->cb, sr);
+}
+
+/**
+ * @brief   Capture service routine, pulse width.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] dp        Dispatch entry of the capture flag
+ * @param[in] sr        The status register snapshot of the interrupt
+ */
+static void eicu_lld_serve_pulse(EICUDriver *eicup,
+                                 const EICUDispatch *dp, uint32_t sr)
+{
+  _eicu_isr_invoke_pulse_width_cb(eicup, dp->channel, dp->cb, dp->pcb, sr);
+}
+
+/**
+ * @brief   Capture service routine, pin sampled pulse width.
+ * @details The channel captures both edges, the pin level read here tells
+ *          which one it was.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] dp        Dispatch entry of the capture flag
+ * @param[in] sr        The status register snapshot of the interrupt
+ */
+static void eicu_lld_serve_pulse_sampled(EICUDriver *eicup,
+                                         const EICUDispatch *dp, uint32_t sr)
+{
+  EICUChannel *chp = &eicup->channels[dp->channel];
+  eicucnt_t capture = eicu_lld_get_compare(eicup, dp->channel);
+  eicutstamp_t stamp = eicu_lld_extend(eicup, capture, sr);
+
+  if (palReadPad(chp->port, chp->pad) == chp->level)
+    _eicu_isr_pulse_start(eicup, dp->channel, dp->pcb, stamp)
+  else
+    _eicu_isr_invoke_pulse_stop_cb(eicup, dp->channel, dp->cb, stamp)
+}
+
+/**
+ * @brief   Capture service routine, paired pulse start edge.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] dp        Dispatch entry of the capture flag
+ * @param[in] sr        The status register snapshot of the interrupt
+ */
+static void eicu_lld_serve_pulse_start(EICUDriver *eicup,
+                                       const EICUDispatch *dp, uint32_t sr)
+{
+  eicucnt_t capture = eicu_lld_get_compare(eicup, dp->channel);
+
+  _eicu_isr_pulse_start(eicup, dp->channel, dp->pcb,
+                        eicu_lld_extend(eicup, capture, sr));
+}
+
+/**
+ * @brief   Capture service routine, paired pulse stop edge.
+ * @details The stop edge is captured on the neighbour channel.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] dp        Dispatch entry of the capture flag
+ * @param[in] sr        The status register snapshot of the interrupt
+ */
+static void eicu_lld_serve_pulse_stop(EICUDriver *eicup,
+                                      const EICUDispatch *dp, uint32_t sr)
+{
+  eicucnt_t capture = eicu_lld_get_compare(eicup, dp->channel ^ 1);
+  eicutstamp_t stamp = eicu_lld_extend(eicup, capture, sr);
+
+  _eicu_isr_invoke_pulse_stop_cb(eicup, dp->channel, dp->cb, stamp)
+}
+
+/**
+ * @brief   Capture service routine, edge detect.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] dp        Dispatch entry of the capture flag
+ * @param[in] sr        The status register snapshot of the interrupt
+ */
+static void eicu_lld_serve_edge(EICUDriver *eicup,
+                                const EICUDispatch *dp, uint32_t sr)
+{
+  _eicu_isr_invoke_edge_detect_cb(eicup, dp->channel, dp->cb, sr);
+}
+
+/**
+ * @brief   Capture service routine, hall sensor transition.
+ * @details The pins are sampled first, as close as possible to the edge,
+ *          then the transition is served as a PWM period.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] dp        Dispatch entry of the capture flag
+ * @param[in] sr        The status register snapshot of the interrupt
+ */
+static void eicu_lld_serve_hall(EICUDriver *eicup,
+                                const EICUDispatch *dp, uint32_t sr)
+{
+  const EICUChannel *chp = eicup->channels;
+
+  eicup->hall = (uint8_t)(palReadPad(chp[0].port, chp[0].pad) |
+                          (palReadPad(chp[1].port, chp[1].pad) << 1) |
+                          (palReadPad(chp[2].port, chp[2].pad) << 2));
+  _eicu_isr_invoke_pwm_period_cb(eicup, dp->channel, dp->cb, sr);
+}
+
+/**
+ * @brief   Capture service routine, time interval start edge.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] dp        Dispatch entry of the capture flag
+ * @param[in] sr        The status register snapshot of the interrupt
+ */
+static void eicu_lld_serve_interval_start(EICUDriver *eicup,
+                                          const EICUDispatch *dp, uint32_t sr)
+{
+  eicucnt_t capture = eicu_lld_get_compare(eicup, dp->channel);
+  eicutstamp_t stamp = eicu_lld_extend(eicup, capture, sr);
+
+  _eicu_isr_invoke_interval_cb(eicup, dp->channel, dp->cb, 1U, stamp)
+}
+
+/**
+ * @brief   Capture service routine, time interval stop edge.
+ * @details The stop edge is captured on the neighbour channel.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] dp        Dispatch entry of the capture flag
+ * @param[in] sr        The status register snapshot of the interrupt
+ */
+static void eicu_lld_serve_interval_stop(EICUDriver *eicup,
+                                         const EICUDispatch *dp, uint32_t sr)
+{
+  eicucnt_t capture = eicu_lld_get_compare(eicup, dp->channel + 1);
+  eicutstamp_t stamp = eicu_lld_extend(eicup, capture, sr);
+
+  _eicu_isr_invoke_interval_cb(eicup, dp->channel, dp->cb, 2U, stamp)
+}
+
+/**
+ * @brief   Capture service routine, frequency counter.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] dp        Dispatch entry of the capture flag
+ * @param[in] sr        The status register snapshot of the interrupt
+ */
+static void eicu_lld_serve_frequency(EICUDriver *eicup,
+                                     const EICUDispatch *dp, uint32_t sr)
+{
+  _eicu_isr_invoke_frequency_cb(eicup, dp->channel, dp->cb, sr);
+}
+
+#if EICU_USE_PPM || defined(__DOXYGEN__)
+/**
+ * @brief   Capture service routine, PPM frame decoder.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] dp        Dispatch entry of the capture flag
+ * @param[in] sr        The status register snapshot of the interrupt
+ */
+static void eicu_lld_serve_ppm(EICUDriver *eicup,
+                               const EICUDispatch *dp, uint32_t sr)
+{
+  _eicu_isr_invoke_ppm_cb(eicup, dp->channel, dp->cb, sr);
+}
+#endif
+
+#if EICU_USE_TIMEBASE || defined(__DOXYGEN__)
+/**
+ * @brief   Capture service routine, timebase reference.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] dp        Dispatch entry of the capture flag
+ * @param[in] sr        The status register snapshot of the interrupt
+ */
+static void eicu_lld_serve_reference(EICUDriver *eicup,
+                                     const EICUDispatch *dp, uint32_t sr)
+{
+  _eicu_isr_invoke_reference_cb(eicup, dp->channel, dp->cb, sr);
+}
+#endif
+
+/**
+ * @brief   Resolves the capture dispatch table of the configuration.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ */
+static void eicu_lld_resolve_dispatch(EICUDriver *eicup)
+{
+  const EICUConfig *cfgp = eicup->config;
+  eicuhandler_t handler;
+  size_t n;
+
+  eicup->late = 0;
+  for (n = 0; n < 4; n++)
+    eicup->dispatch[n].pcb = NULL;
+
+  if (cfgp->input_type == EICU_INPUT_PWM) {
+    /* The width capture belongs to the cycle ended by a period capture
+       pending in the same interrupt, so the period is served last.*/
+    if (cfgp->iccfgp[0] != NULL) {
+      eicup->dispatch[0].handler = eicu_lld_serve_pwm_period;
+      eicup->dispatch[0].cb      = cfgp->period_cb;
+      eicup->dispatch[0].channel = EICU_CHANNEL_1;
+      eicup->dispatch[1].handler = eicu_lld_serve_pwm_width;
+      eicup->dispatch[1].cb      = cfgp->iccfgp[0]->width_cb;
+      eicup->dispatch[1].channel = EICU_CHANNEL_1;
+      eicup->late = STM32_TIM_SR_CC1IF;
+    } else {
+      eicup->dispatch[0].handler = eicu_lld_serve_pwm_width;
+      eicup->dispatch[0].cb      = cfgp->iccfgp[1]->width_cb;
+      eicup->dispatch[0].channel = EICU_CHANNEL_2;
+      eicup->dispatch[1].handler = eicu_lld_serve_pwm_period;
+      eicup->dispatch[1].cb      = cfgp->period_cb;
+      eicup->dispatch[1].channel = EICU_CHANNEL_2;
+      eicup->late = STM32_TIM_SR_CC2IF;
+    }
+    return;
+  }
+
+  if (cfgp->input_type == EICU_INPUT_HALL) {
+    eicup->dispatch[0].handler = eicu_lld_serve_hall;
+    eicup->dispatch[0].cb      = cfgp->period_cb;
+    eicup->dispatch[0].channel = EICU_CHANNEL_1;
+    return;
+  }
+
+  switch (cfgp->input_type) {
+  case EICU_INPUT_FREQUENCY:
+    handler = eicu_lld_serve_frequency;
+    break;
+#if EICU_USE_PPM
+  case EICU_INPUT_PPM:
+    /* A single decoder per driver.*/
+    osalDbgAssert((cfgp->iccfgp[0] != NULL) + (cfgp->iccfgp[1] != NULL) +
+                  (cfgp->iccfgp[2] != NULL) + (cfgp->iccfgp[3] != NULL) == 1,
+                  "only one PPM channel allowed");
+    handler = eicu_lld_serve_ppm;
+    break;
+#endif
+  default:
+    handler = eicu_lld_serve_edge;
+    break;
+  }
+  for (n = 0; n < 4; n++) {
+    eicup->dispatch[n].handler = handler;
+    eicup->dispatch[n].cb      = (cfgp->iccfgp[n] != NULL) ?
+                                 cfgp->iccfgp[n]->width_cb : NULL;
+    eicup->dispatch[n].channel = (eicuchannel_t)n;
+  }
+
+  if (cfgp->input_type == EICU_INPUT_INTERVAL) {
+    for (n = 0; n < 4; n += 2) {
+      if ((cfgp->iccfgp[n] == NULL) || (cfgp->iccfgp[n + 1] == NULL))
+        continue;
+      eicup->dispatch[n].handler     = eicu_lld_serve_interval_start;
+      eicup->dispatch[n + 1].handler = eicu_lld_serve_interval_stop;
+      eicup->dispatch[n + 1].cb      = cfgp->iccfgp[n]->width_cb;
+      eicup->dispatch[n + 1].channel = (eicuchannel_t)n;
+    }
+    return;
+  }
+
+  if (!eicu_lld_uses_pulse(cfgp))
+    return;
+
+  for (n = 0; n < 4; n++) {
+    if (cfgp->iccfgp[n] == NULL)
+      continue;
+
+    switch (cfgp->iccfgp[n]->pulse) {
+    case EICU_PULSE_BOTH_EDGES:
+      handler = eicu_lld_serve_pulse_sampled;
+      break;
+    case EICU_PULSE_PAIRED:
+      /* The stop edge on the neighbour channel is served after a start
+         edge pending in the same interrupt.*/
+      handler = eicu_lld_serve_pulse_start;
+      eicup->dispatch[n ^ 1].handler = eicu_lld_serve_pulse_stop;
+      eicup->dispatch[n ^ 1].cb      = cfgp->iccfgp[n]->width_cb;
+      eicup->dispatch[n ^ 1].channel = (eicuchannel_t)n;
+      eicup->late |= STM32_TIM_SR_CC1IF << (n ^ 1);
+      break;
+    default:
+      handler = eicu_lld_serve_pulse;
+      break;
+    }
+    eicup->dispatch[n].handler = handler;
+    if (cfgp->input_type == EICU_INPUT_PWM_MULTI)
+      eicup->dispatch[n].pcb = cfgp->period_cb;
+  }
+}
+
+#if EICU_USE_TIMEBASE || defined(__DOXYGEN__)
+/**
+ * @brief   Routes the reference channels to the timebase.
+ * @details A reference channel replaces the handler of its input type,
+ *          its width callback receives the accepted reference periods.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ */
+static void eicu_lld_resolve_reference(EICUDriver *eicup)
+{
+  const EICUConfig *cfgp = eicup->config;
+  size_t n;
+
+  for (n = 0; n < 4; n++) {
+    if ((cfgp->iccfgp[n] == NULL) || (cfgp->iccfgp[n]->ref_period == 0))
+      continue;
+
+    osalDbgAssert((cfgp->input_type == EICU_INPUT_EDGE) ||
+                  (cfgp->input_type == EICU_INPUT_FREQUENCY) ||
+                  (cfgp->input_type == EICU_INPUT_PULSE) ||
+                  (cfgp->input_type == EICU_INPUT_PWM_MULTI),
+                  "reference not allowed in this mode");
+    osalDbgAssert((cfgp->iccfgp[n]->prescaler == EICU_PSC_1) &&
+                  (!eicu_lld_uses_pulse(cfgp) ||
+                   (cfgp->iccfgp[n]->pulse == EICU_PULSE_POLARITY_FLIP)),
+                  "reference must capture every edge of one polarity");
+    osalDbgAssert(cfgp->iccfgp[n]->ref_filter < 32, "invalid filter");
+
+    eicup->dispatch[n].handler = eicu_lld_serve_reference;
+    eicup->dispatch[n].cb      = cfgp->iccfgp[n]->width_cb;
+    eicup->dispatch[n].pcb     = NULL;
+    eicup->dispatch[n].channel = (eicuchannel_t)n;
+  }
+}
+#endif
+
+#if EICU_LLD_HAS_FIXED_ISR || defined(__DOXYGEN__)
+/**
+ * @brief   Checks a configuration against a specialized IRQ handler.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] type      The input type the handler was compiled for
+ * @param[in] chmask    The channels the handler serves, channel 1 in bit 0
+ */
+static void eicu_lld_check_fixed(EICUDriver *eicup, eicuinput_t type,
+                                 uint32_t chmask)
+{
+  const EICUConfig *cfgp = eicup->config;
+  size_t n;
+
+  osalDbgAssert(cfgp->input_type == type, "input type not served by the ISR");
+  for (n = 0; n < 4; n++) {
+    if (cfgp->iccfgp[n] == NULL)
+      continue;
+    osalDbgAssert((chmask & (1U << n)) != 0, "channel not served by the ISR");
+    /* The stop edges of a paired engine are captured by the neighbour.*/
+    osalDbgAssert(!eicu_lld_uses_pulse(cfgp) ||
+                  (cfgp->iccfgp[n]->pulse != EICU_PULSE_PAIRED) ||
+                  ((chmask & (1U << (n ^ 1))) != 0),
+                  "paired channel not served by the ISR");
+  }
+}
+#endif
+
+/**
+ * @brief   Configures the input prescaler and filter of a channel.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] n         The channel to configure.
+ */
+static void eicu_lld_config_input(EICUDriver *eicup, size_t n)
+{
+  const EICU_IC_Settings *icp = eicup->config->iccfgp[n];
+  EICUChannel *chp = &eicup->channels[n];
+  uint64_t range;
+  uint32_t ccmr;
+
+  if (icp == NULL)
+    return;
+
+  osalDbgAssert((icp->prescaler == EICU_PSC_1) ||
+                (eicup->config->input_type == EICU_INPUT_EDGE) ||
+                (eicup->config->input_type == EICU_INPUT_FREQUENCY),
+                "prescaler only allowed in edge and frequency modes");
+  osalDbgAssert((icp->gate > 0) ||
+                (eicup->config->input_type != EICU_INPUT_FREQUENCY),
+                "invalid gate time");
+  osalDbgAssert(EICU_USE_PPM ||
+                (eicup->config->input_type != EICU_INPUT_PPM),
+                "PPM support disabled");
+  osalDbgAssert(EICU_USE_ENCODER ||
+                (eicup->config->input_type != EICU_INPUT_ENCODER),
+                "encoder support disabled");
+  osalDbgAssert(icp->filter <= 15, "invalid filter");
+
+  /* Settings read by the ISR, copied to RAM next to the channel state.*/
+  chp->psc  = (uint8_t)icp->prescaler;
+  chp->port = icp->port;
+  chp->pad  = icp->pad;
+  chp->gate = icp->gate;
+  chp->navg = icp->interval_avg;
+#if EICU_USE_AGGREGATION
+  chp->agg_samples = icp->agg_samples;
+  chp->agg_ticks   = icp->agg_ticks;
+#endif
+#if EICU_USE_DEADBAND
+  chp->deadband_width   = icp->deadband_width;
+  chp->deadband_period  = icp->deadband_period;
+  chp->deadband_refresh = icp->deadband_refresh;
+#endif
+#if EICU_USE_TIMEBASE
+  chp->ref_period = icp->ref_period;
+  chp->ref_filter = icp->ref_filter;
+#endif
+#if EICU_USE_PPM
+  if (eicup->config->input_type == EICU_INPUT_PPM) {
+    eicup->ppm.sync     = icp->ppm_sync;
+    eicup->ppm.min      = icp->ppm_min;
+    eicup->ppm.max      = icp->ppm_max;
+    eicup->ppm.channels = icp->ppm_channels;
+  }
+#endif
+
+  /* The timeout is counted in whole counter periods, rounded up.*/
+  if (icp->timeout > 0) {
+    range = (uint64_t)eicu_lld_get_top(eicup) + 1;
+    osalDbgAssert((uint64_t)icp->timeout >= range,
+                  "timeout shorter than the counter period");
+#if STM32_EICU_USE_DMA
+    /* DMA captures are not seen by the ISR, the input would always time
+       out.*/
+    osalDbgAssert(icp->dma_buffer == NULL, "timeout not allowed with DMA");
+#endif
+    chp->tlimit = (uint32_t)((icp->timeout + range - 1) / range);
+    eicup->tmask |= 1U << n;
+  }
+
+  /* The hall inputs are filtered on TI1, after the XOR.*/
+  if ((eicup->config->input_type == EICU_INPUT_HALL) && (n != 0))
+    return;
+
+  /* ICxPSC and ICxF fields, the channel pairs share a CCMR register.*/
+  ccmr = (STM32_TIM_CCMR1_IC1PSC(icp->prescaler) |
+          STM32_TIM_CCMR1_IC1F(icp->filter)) << ((n & 1) * 8);
+  if (n < 2)
+    eicup->tim->CCMR1 |= ccmr;
+  else
+    eicup->tim->CCMR2 |= ccmr;
+}
+
+/**
+ * @brief   Configures the pulse engine of a channel.
+ * @details Both the pin sampled and the paired engines leave CCER alone in
+ *          the ISR.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] n         The channel to configure.
+ */
+static void eicu_lld_config_pulse(EICUDriver *eicup, size_t n)
+{
+  const EICU_IC_Settings *icp = eicup->config->iccfgp[n];
+  EICUChannel *chp = &eicup->channels[n];
+  size_t m = n ^ 1;
+  uint32_t ccmr, ccer;
+
+  if (icp == NULL)
+    return;
+
+  chp->level = (icp->mode == EICU_INPUT_ACTIVE_HIGH) ? PAL_HIGH : PAL_LOW;
+
+  if (icp->pulse == EICU_PULSE_BOTH_EDGES) {
+    /* CCxP = CCxNP = 1, capture on both edges.*/
+    eicup->tim->CCER |= (STM32_TIM_CCER_CC1P | STM32_TIM_CCER_CC1NP) <<
+                        (n * 4);
+  }
+  else if (icp->pulse == EICU_PULSE_PAIRED) {
+    osalDbgAssert(eicup->config->iccfgp[m] == NULL,
+                  "neighbour channel in use");
+
+    /* The neighbour channel captures the opposite edge of the same input,
+       CCxS = 10.*/
+    ccmr = STM32_TIM_CCMR1_CC1S(2) << ((m & 1) * 8);
+    if (m < 2)
+      eicup->tim->CCMR1 |= ccmr;
+    else
+      eicup->tim->CCMR2 |= ccmr;
+
+    ccer = STM32_TIM_CCER_CC1E;
+    if (icp->mode == EICU_INPUT_ACTIVE_HIGH)
+      ccer |= STM32_TIM_CCER_CC1P;
+    eicup->tim->CCER |= ccer << (m * 4);
+
+    eicup->wccrp[m] = &eicup->tim->CCR[m];
+  }
+}
+
+/**
+ * @brief   Serves a set of pending capture flags.
+ * @details Only the set flags are visited, highest channel first. With a
+ *          fixed input type the handler is called directly when it does
+ *          not depend on the channel.
  *
  * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] type      The fixed input type or @p EICU_LLD_INPUT_ANY
+ * @param[in] cc        The pending CC flags to serve
+ * @param[in] sr        The status register snapshot of the interrupt
  */
-static void eicu_lld_serve_interrupt(EICUDriver *eicup)
+static EICU_LLD_FORCE_INLINE void eicu_lld_serve_captures(EICUDriver *eicup,
+                                                          eicuinput_t type,
+                                                          uint32_t cc,
+                                                          uint32_t sr)
 {
-  uint16_t sr;
+  const EICUDispatch *dp;
+  uint32_t n;
+
+  while (cc != 0) {
+    /* CCxIF is bit x of the status register.*/
+    n  = 31 - __CLZ(cc);
+    cc &= ~(1U << n);
+    dp = &eicup->dispatch[n - 1];
+#if EICU_USE_STATISTICS
+    eicup->stats.captures[dp->channel]++;
+#endif
+    /* Only an edge of the channel input itself proves it alive, not the
+       stop edge of an interval or paired neighbour.*/
+    eicup->seen |= 1U << (n - 1);
+    if (type == EICU_INPUT_HALL)
+      eicu_lld_serve_hall(eicup, dp, sr);
+#if !EICU_USE_TIMEBASE
+    /* Without reference channels these types use one handler for all.*/
+    else if (type == EICU_INPUT_EDGE)
+      eicu_lld_serve_edge(eicup, dp, sr);
+    else if (type == EICU_INPUT_FREQUENCY)
+      eicu_lld_serve_frequency(eicup, dp, sr);
+#if EICU_USE_PPM
+    else if (type == EICU_INPUT_PPM)
+      eicu_lld_serve_ppm(eicup, dp, sr);
+#endif
+#endif
+    else
+      dp->handler(eicup, dp, sr);
+  }
+}
+
+/**
+ * @brief   Accounts and reports overcaptures.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] of        The overcapture flags, aligned to the CCxIF bits
+ */
+static void eicu_lld_serve_overcaptures(EICUDriver *eicup, uint32_t of)
+{
+  eicuchannel_t channel;
+  uint32_t n;
+
+  while (of != 0) {
+    n  = 31 - __CLZ(of);
+    of &= ~(1U << n);
+    channel = eicup->dispatch[n - 1].channel;
+#if EICU_USE_STATISTICS
+    eicup->stats.overcaptures[channel]++;
+#endif
+    if (eicup->error_cb != NULL)
+      eicup->error_cb(eicup, channel);
+  }
+}
+
+#if EICU_USE_ENCODER || defined(__DOXYGEN__)
+/**
+ * @brief   Extends the encoder position on a counter overflow.
+ * @details The counter wraps in both directions, the side of the range it
+ *          is in tells an overflow from an underflow.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ */
+static void eicu_lld_serve_encoder_overflow(EICUDriver *eicup)
+{
+  if ((eicucnt_t)eicup->tim->CNT <= (eicu_lld_get_top(eicup) >> 1))
+    eicup->epoch += eicu_lld_get_epoch_increment(eicup);
+  else
+    eicup->epoch -= eicu_lld_get_epoch_increment(eicup);
+  if (eicup->overflow_cb != NULL)
+    eicup->overflow_cb(eicup, 0);
+}
+#endif
+
+/**
+ * @brief   Checks the input loss timeouts on a counter overflow.
+ * @details A capture since the previous overflow re-arms the timeout of its
+ *          channel, else one more silent counter period is accounted.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ */
+static void eicu_lld_serve_timeouts(EICUDriver *eicup)
+{
+  uint32_t tmask = eicup->tmask;
+  EICUChannel *chp;
+  uint32_t n;
+
+  while (tmask != 0) {
+    n = 31 - __CLZ(tmask);
+    tmask &= ~(1U << n);
+    chp = &eicup->channels[n];
+    if ((eicup->seen & (1U << n)) != 0)
+      chp->silent = 0;
+    else if (++chp->silent == chp->tlimit) {
+      /* Reported once, the measurement restarts at the next edge.*/
+      chp->state = EICU_WAITING;
+      if (eicup->timeout_cb != NULL)
+        eicup->timeout_cb(eicup, (eicuchannel_t)n);
+    }
+  }
+  eicup->seen = 0;
+}
+
+/**
+ * @brief   IRQ handler specialized for an input type.
+ * @details With constant arguments the paths of other input types and
+ *          channels are removed at compile time. Only the status flags of
+ *          the served sources are cleared, so timers with separate update
+ *          and capture vectors serve each flag once.
+ * @note    An update pass also serves the pending captures first, their
+ *          timestamps need the epoch before the overflow. A capture pass
+ *          leaves a pending overflow to the update vector, its timestamps
+ *          already account for it.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] type      The fixed input type or @p EICU_LLD_INPUT_ANY
+ * @param[in] chmask    The channels in use, channel 1 in bit 0
+ * @param[in] sources   The interrupt sources of the vector
+ */
+static EICU_LLD_FORCE_INLINE void
+eicu_lld_serve_interrupt_fixed(EICUDriver *eicup, eicuinput_t type,
+                               uint32_t chmask, uint32_t sources)
+{
+  uint32_t sr, of, cc, up, late, ccmask;
+
+  /* CC flags the input type can raise, CCxIF is bit x.*/
+  if (type == EICU_INPUT_HALL)
+    ccmask = STM32_TIM_SR_CC1IF;
+  else if (type == EICU_INPUT_PWM)
+    ccmask = STM32_TIM_SR_CC1IF | STM32_TIM_SR_CC2IF;
+  else if (type == EICU_INPUT_ENCODER)
+    ccmask = 0;
+  else
+    ccmask = (chmask & 0x0FU) << 1;
+
   sr = eicup->tim->SR;
 
+  /* Overcaptures of the served channels, CCxOF is CCxIF shifted by 8.*/
+  of = (sr >> 8) & eicup->irqmask & ccmask;
+
   /* Pick out the interrupts we are interested in by using
      the interrupt enable bits as mask */
-  sr &= (eicup->tim->DIER & STM32_TIM_DIER_IRQ_MASK);
+  sr &= eicup->irqmask;
+
+  /* An update pass first serves the pending captures, their timestamps
+     need the epoch before the overflow.*/
+  if (((sources & EICU_LLD_SRC_UP) != 0) && ((sr & STM32_TIM_SR_UIF) != 0))
+    sources |= EICU_LLD_SRC_CC;
+  if ((sources & EICU_LLD_SRC_CC) == 0)
+    of = 0;
+  cc = sr & ccmask & sources;
+  up = sr & sources & EICU_LLD_SRC_UP;
+
+  /* Clear the served interrupts only.*/
+  eicup->tim->SR = ~(cc | up | (of << 8));
+
+#if EICU_USE_STATISTICS
+  eicup->stats.isr++;
+  if ((cc | up | of) == 0)
+    eicup->stats.spurious++;
+#endif
 
-  /* Clear interrupts */
-  eicup->tim->SR = ~sr;
+  if (of != 0)
+    eicu_lld_serve_overcaptures(eicup, of);
 
-  if (eicup->config->input_type == EICU_INPUT_PWM) {
-    if (eicup->config->iccfgp[0] != NULL) {
-      if ((sr & STM32_TIM_SR_CC1IF) != 0)
-        _eicu_isr_invoke_pwm_period_cb(eicup, EICU_CHANNEL_1);
-      if ((sr & STM32_TIM_SR_CC2IF) != 0)
-        _eicu_isr_invoke_pwm_width_cb(eicup, EICU_CHANNEL_1);
-    } else {
-      if ((sr & STM32_TIM_SR_CC1IF) != 0)
-        _eicu_isr_invoke_pwm_width_cb(eicup, EICU_CHANNEL_2);
-      if ((sr & STM32_TIM_SR_CC2IF) != 0)
-        _eicu_isr_invoke_pwm_period_cb(eicup, EICU_CHANNEL_2);
-    }
-  } else if (eicup->config->input_type == EICU_INPUT_PULSE) {
-    if ((sr & STM32_TIM_SR_CC1IF) != 0)
-      _eicu_isr_invoke_pulse_width_cb(eicup, EICU_CHANNEL_1);
-    if ((sr & STM32_TIM_SR_CC2IF) != 0)
-      _eicu_isr_invoke_pulse_width_cb(eicup, EICU_CHANNEL_2);
-    if ((sr & STM32_TIM_SR_CC3IF) != 0)
-      _eicu_isr_invoke_pulse_width_cb(eicup, EICU_CHANNEL_3);
-    if ((sr & STM32_TIM_SR_CC4IF) != 0)
-      _eicu_isr_invoke_pulse_width_cb(eicup, EICU_CHANNEL_4);
-  } else {  /* EICU_INPUT_EDGE */
-    if ((sr & STM32_TIM_SR_CC1IF) != 0)
-      _eicu_isr_invoke_edge_detect_cb(eicup, EICU_CHANNEL_1);
-    if ((sr & STM32_TIM_SR_CC2IF) != 0)
-      _eicu_isr_invoke_edge_detect_cb(eicup, EICU_CHANNEL_2);
-    if ((sr & STM32_TIM_SR_CC3IF) != 0)
-      _eicu_isr_invoke_edge_detect_cb(eicup, EICU_CHANNEL_3);
-    if ((sr & STM32_TIM_SR_CC4IF) != 0)
-      _eicu_isr_invoke_edge_detect_cb(eicup, EICU_CHANNEL_4);
-  }
-
-  if ((sr & STM32_TIM_SR_UIF) != 0)
+  /* Only the PWM and pulse engines serve some flags late.*/
+  if ((type == EICU_LLD_INPUT_ANY) || (type == EICU_INPUT_PWM) ||
+      (type == EICU_INPUT_PULSE) || (type == EICU_INPUT_PWM_MULTI)) {
+    late = cc & eicup->late;
+    eicu_lld_serve_captures(eicup, type, cc & ~late, sr);
+    eicu_lld_serve_captures(eicup, type, late, sr);
+  }
+  else
+    eicu_lld_serve_captures(eicup, type, cc, sr);
+
+  /* One wakeup for all the channels measured in this interrupt.*/
+  _eicu_isr_broadcast(eicup)
+
+  /* The epoch is advanced after the captures, which already accounted for
+     an overflow pending in the same status register read.*/
+  if (up != 0) {
+#if EICU_USE_ENCODER
+    if ((type == EICU_INPUT_ENCODER) ||
+        ((type == EICU_LLD_INPUT_ANY) &&
+         (eicup->input_type == EICU_INPUT_ENCODER))) {
+      eicu_lld_serve_encoder_overflow(eicup);
+      return;
+    }
+#endif
     _eicu_isr_invoke_overflow_cb(eicup);
+    if (eicup->tmask != 0)
+      eicu_lld_serve_timeouts(eicup);
+  }
+}
+
+#if EICU_LLD_HAS_GENERIC_ISR || defined(__DOXYGEN__)
+/**
+ * @brief   Shared IRQ handler.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @param[in] sources   The interrupt sources of the vector
+ */
+static void eicu_lld_serve_interrupt(EICUDriver *eicup, uint32_t sources)
+{
+  eicu_lld_serve_interrupt_fixed(eicup, EICU_LLD_INPUT_ANY, 0x0FU, sources);
 }
+#endif
 
 /*===========================================================================*/
 /* Driver interrupt handlers.                                                */
@@ -178,7 +1046,7 @@ static void eicu_lld_serve_interrupt(EICUDriver *eicup)
 #error "STM32_TIM1_UP_HANDLER not defined"
 #endif
 /**
- * @brief   TIM1 compare interrupt handler.
+ * @brief   TIM1 update interrupt handler.
  * @note    It is assumed that the various sources are only activated if the
  *          associated callback pointer is not equal to @p NULL in order to not
  *          perform an extra check in a potentially critical interrupt handler.
@@ -189,7 +1057,12 @@ OSAL_IRQ_HANDLER(STM32_TIM1_UP_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
-  eicu_lld_serve_interrupt(&EICUD1);
+#if defined(STM32_EICU_TIM1_INPUT_TYPE)
+  eicu_lld_serve_interrupt_fixed(&EICUD1, STM32_EICU_TIM1_INPUT_TYPE,
+                                 STM32_EICU_TIM1_CHANNELS, EICU_LLD_SRC_UP);
+#else
+  eicu_lld_serve_interrupt(&EICUD1, EICU_LLD_SRC_UP);
+#endif
 
   OSAL_IRQ_EPILOGUE();
 }
@@ -198,7 +1071,7 @@ OSAL_IRQ_HANDLER(STM32_TIM1_UP_HANDLER) {
 #error "STM32_TIM1_CC_HANDLER not defined"
 #endif
 /**
- * @brief   TIM1 compare interrupt handler.
+ * @brief   TIM1 capture interrupt handler.
  * @note    It is assumed that the various sources are only activated if the
  *          associated callback pointer is not equal to @p NULL in order to not
  *          perform an extra check in a potentially critical interrupt handler.
@@ -209,7 +1082,12 @@ OSAL_IRQ_HANDLER(STM32_TIM1_CC_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
-  eicu_lld_serve_interrupt(&EICUD1);
+#if defined(STM32_EICU_TIM1_INPUT_TYPE)
+  eicu_lld_serve_interrupt_fixed(&EICUD1, STM32_EICU_TIM1_INPUT_TYPE,
+                                 STM32_EICU_TIM1_CHANNELS, EICU_LLD_SRC_CC);
+#else
+  eicu_lld_serve_interrupt(&EICUD1, EICU_LLD_SRC_CC);
+#endif
 
   OSAL_IRQ_EPILOGUE();
 }
@@ -232,7 +1110,12 @@ OSAL_IRQ_HANDLER(STM32_TIM2_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
-  eicu_lld_serve_interrupt(&EICUD2);
+#if defined(STM32_EICU_TIM2_INPUT_TYPE)
+  eicu_lld_serve_interrupt_fixed(&EICUD2, STM32_EICU_TIM2_INPUT_TYPE,
+                                 STM32_EICU_TIM2_CHANNELS, EICU_LLD_SRC_ALL);
+#else
+  eicu_lld_serve_interrupt(&EICUD2, EICU_LLD_SRC_ALL);
+#endif
 
   OSAL_IRQ_EPILOGUE();
 }
@@ -254,7 +1137,12 @@ OSAL_IRQ_HANDLER(STM32_TIM3_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
-  eicu_lld_serve_interrupt(&EICUD3);
+#if defined(STM32_EICU_TIM3_INPUT_TYPE)
+  eicu_lld_serve_interrupt_fixed(&EICUD3, STM32_EICU_TIM3_INPUT_TYPE,
+                                 STM32_EICU_TIM3_CHANNELS, EICU_LLD_SRC_ALL);
+#else
+  eicu_lld_serve_interrupt(&EICUD3, EICU_LLD_SRC_ALL);
+#endif
 
   OSAL_IRQ_EPILOGUE();
 }
@@ -276,7 +1164,12 @@ OSAL_IRQ_HANDLER(STM32_TIM4_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
-  eicu_lld_serve_interrupt(&EICUD4);
+#if defined(STM32_EICU_TIM4_INPUT_TYPE)
+  eicu_lld_serve_interrupt_fixed(&EICUD4, STM32_EICU_TIM4_INPUT_TYPE,
+                                 STM32_EICU_TIM4_CHANNELS, EICU_LLD_SRC_ALL);
+#else
+  eicu_lld_serve_interrupt(&EICUD4, EICU_LLD_SRC_ALL);
+#endif
 
   OSAL_IRQ_EPILOGUE();
 }
@@ -298,7 +1191,12 @@ OSAL_IRQ_HANDLER(STM32_TIM5_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
-  eicu_lld_serve_interrupt(&EICUD5);
+#if defined(STM32_EICU_TIM5_INPUT_TYPE)
+  eicu_lld_serve_interrupt_fixed(&EICUD5, STM32_EICU_TIM5_INPUT_TYPE,
+                                 STM32_EICU_TIM5_CHANNELS, EICU_LLD_SRC_ALL);
+#else
+  eicu_lld_serve_interrupt(&EICUD5, EICU_LLD_SRC_ALL);
+#endif
 
   OSAL_IRQ_EPILOGUE();
 }
@@ -309,7 +1207,7 @@ OSAL_IRQ_HANDLER(STM32_TIM5_HANDLER) {
 #error "STM32_TIM8_UP_HANDLER not defined"
 #endif
 /**
- * @brief   TIM8 compare interrupt handler.
+ * @brief   TIM8 update interrupt handler.
  * @note    It is assumed that the various sources are only activated if the
  *          associated callback pointer is not equal to @p NULL in order to not
  *          perform an extra check in a potentially critical interrupt handler.
@@ -320,7 +1218,12 @@ OSAL_IRQ_HANDLER(STM32_TIM8_UP_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
-  eicu_lld_serve_interrupt(&EICUD8);
+#if defined(STM32_EICU_TIM8_INPUT_TYPE)
+  eicu_lld_serve_interrupt_fixed(&EICUD8, STM32_EICU_TIM8_INPUT_TYPE,
+                                 STM32_EICU_TIM8_CHANNELS, EICU_LLD_SRC_UP);
+#else
+  eicu_lld_serve_interrupt(&EICUD8, EICU_LLD_SRC_UP);
+#endif
 
   OSAL_IRQ_EPILOGUE();
 }
@@ -329,7 +1232,7 @@ OSAL_IRQ_HANDLER(STM32_TIM8_UP_HANDLER) {
 #error "STM32_TIM8_CC_HANDLER not defined"
 #endif
 /**
- * @brief   TIM8 compare interrupt handler.
+ * @brief   TIM8 capture interrupt handler.
  * @note    It is assumed that the various sources are only activated if the
  *          associated callback pointer is not equal to @p NULL in order to not
  *          perform an extra check in a potentially critical interrupt handler.
@@ -340,7 +1243,12 @@ OSAL_IRQ_HANDLER(STM32_TIM8_CC_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
-  eicu_lld_serve_interrupt(&EICUD8);
+#if defined(STM32_EICU_TIM8_INPUT_TYPE)
+  eicu_lld_serve_interrupt_fixed(&EICUD8, STM32_EICU_TIM8_INPUT_TYPE,
+                                 STM32_EICU_TIM8_CHANNELS, EICU_LLD_SRC_CC);
+#else
+  eicu_lld_serve_interrupt(&EICUD8, EICU_LLD_SRC_CC);
+#endif
 
   OSAL_IRQ_EPILOGUE();
 }
@@ -362,7 +1270,12 @@ OSAL_IRQ_HANDLER(STM32_TIM9_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
-  eicu_lld_serve_interrupt(&EICUD9);
+#if defined(STM32_EICU_TIM9_INPUT_TYPE)
+  eicu_lld_serve_interrupt_fixed(&EICUD9, STM32_EICU_TIM9_INPUT_TYPE,
+                                 STM32_EICU_TIM9_CHANNELS, EICU_LLD_SRC_ALL);
+#else
+  eicu_lld_serve_interrupt(&EICUD9, EICU_LLD_SRC_ALL);
+#endif
 
   OSAL_IRQ_EPILOGUE();
 }
@@ -384,7 +1297,12 @@ OSAL_IRQ_HANDLER(STM32_TIM12_HANDLER) {
 
   OSAL_IRQ_PROLOGUE();
 
-  eicu_lld_serve_interrupt(&EICUD12);
+#if defined(STM32_EICU_TIM12_INPUT_TYPE)
+  eicu_lld_serve_interrupt_fixed(&EICUD12, STM32_EICU_TIM12_INPUT_TYPE,
+                                 STM32_EICU_TIM12_CHANNELS, EICU_LLD_SRC_ALL);
+#else
+  eicu_lld_serve_interrupt(&EICUD12, EICU_LLD_SRC_ALL);
+#endif
 
   OSAL_IRQ_EPILOGUE();
 }
@@ -404,48 +1322,76 @@ void eicu_lld_init(void) {
   /* Driver initialization.*/
   eicuObjectInit(&EICUD1);
   EICUD1.tim = STM32_TIM1;
+#if STM32_EICU_HAS_32BIT_TIMERS
+  EICUD1.top = EICU_LLD_TOP_16BITS;
+#endif
 #endif
 
 #if STM32_EICU_USE_TIM2
   /* Driver initialization.*/
   eicuObjectInit(&EICUD2);
   EICUD2.tim = STM32_TIM2;
+#if STM32_TIM2_IS_32BITS
+  EICUD2.top = EICU_LLD_TOP_32BITS;
+#else
+  EICUD2.top = EICU_LLD_TOP_16BITS;
+#endif
 #endif
 
 #if STM32_EICU_USE_TIM3
   /* Driver initialization.*/
   eicuObjectInit(&EICUD3);
   EICUD3.tim = STM32_TIM3;
+#if STM32_EICU_HAS_32BIT_TIMERS
+  EICUD3.top = EICU_LLD_TOP_16BITS;
+#endif
 #endif
 
 #if STM32_EICU_USE_TIM4
   /* Driver initialization.*/
   eicuObjectInit(&EICUD4);
   EICUD4.tim = STM32_TIM4;
+#if STM32_EICU_HAS_32BIT_TIMERS
+  EICUD4.top = EICU_LLD_TOP_16BITS;
+#endif
 #endif
 
 #if STM32_EICU_USE_TIM5
   /* Driver initialization.*/
   eicuObjectInit(&EICUD5);
   EICUD5.tim = STM32_TIM5;
+#if STM32_TIM5_IS_32BITS
+  EICUD5.top = EICU_LLD_TOP_32BITS;
+#else
+  EICUD5.top = EICU_LLD_TOP_16BITS;
+#endif
 #endif
 
 #if STM32_EICU_USE_TIM8
   /* Driver initialization.*/
   eicuObjectInit(&EICUD8);
   EICUD8.tim = STM32_TIM8;
+#if STM32_EICU_HAS_32BIT_TIMERS
+  EICUD8.top = EICU_LLD_TOP_16BITS;
+#endif
 #endif
 
 #if STM32_EICU_USE_TIM9
   /* Driver initialization.*/
   eicuObjectInit(&EICUD9);
   EICUD9.tim = STM32_TIM9;
+#if STM32_EICU_HAS_32BIT_TIMERS
+  EICUD9.top = EICU_LLD_TOP_16BITS;
+#endif
 #endif
 
 #if STM32_EICU_USE_TIM12
   /* Driver initialization.*/
   eicuObjectInit(&EICUD12);
   EICUD12.tim = STM32_TIM12;
+#if STM32_EICU_HAS_32BIT_TIMERS
+  EICUD12.top = EICU_LLD_TOP_16BITS;
+#endif
 #endif
 }
 
@@ -458,6 +1404,7 @@ void eicu_lld_init(void) {
  */
 void eicu_lld_start(EICUDriver *eicup) {
   uint32_t psc;
+  size_t n;
 
   osalDbgAssert((eicup->config->iccfgp[0] != NULL) ||
                 (eicup->config->iccfgp[1] != NULL) ||
@@ -543,6 +1490,10 @@ void eicu_lld_start(EICUDriver *eicup) {
 #endif
   }
   else {
+#if STM32_EICU_USE_DMA
+    /* Streams of the previous configuration are released first.*/
+    eicu_lld_dma_release(eicup);
+#endif
     /* Driver re-configuration scenario, it must be stopped first.*/
     eicup->tim->CR1    = 0;                  /* Timer disabled.              */
     eicup->tim->DIER   = eicup->config->dier &/* DMA-related DIER settings.   */
@@ -553,21 +1504,24 @@ void eicu_lld_start(EICUDriver *eicup) {
     eicup->tim->CNT    = 0;                  /* Counter reset to zero.       */
   }
 
-  /* Timer configuration.*/
-  psc = (eicup->clock / eicup->config->frequency) - 1;
-  chDbgAssert((psc <= 0xFFFF) &&
-             ((psc + 1) * eicup->config->frequency) == eicup->clock,
-               "invalid frequency");
+  /* Timer configuration, encoders count every edge.*/
+  if (eicup->config->input_type == EICU_INPUT_ENCODER)
+    psc = 0;
+  else {
+    psc = (eicup->clock / eicup->config->frequency) - 1;
+    chDbgAssert((psc <= 0xFFFF) &&
+               ((psc + 1) * eicup->config->frequency) == eicup->clock,
+                 "invalid frequency");
+  }
   eicup->tim->PSC   = (uint16_t)psc;
-  eicup->tim->ARR   = 0xFFFF;
+  eicup->tim->ARR   = eicu_lld_get_top(eicup);
 
   /* Reset registers */
+  eicup->irqmask    = 0;
+  eicup->tim->CR2   = 0;
   eicup->tim->SMCR  = 0;
   eicup->tim->CCMR1 = 0;
-  eicup->last_count[0] = 0;
-  eicup->last_count[1] = 0;
-  eicup->last_count[2] = 0;
-  eicup->last_count[3] = 0;
+  eicup->tim->CCER  = 0;
 
 #if STM32_EICU_USE_TIM9 && !STM32_EICU_USE_TIM12
   if (eicup != &EICUD9)
@@ -635,7 +1589,45 @@ void eicu_lld_start(EICUDriver *eicup) {
       eicup->wccrp[1] = &eicup->tim->CCR[0];
       eicup->pccrp = &eicup->tim->CCR[1];
     }
-  } else { /* EICU_INPUT_EDGE & EICU_INPUT_PULSE */
+  } else if (eicup->config->input_type == EICU_INPUT_HALL) {
+    osalDbgAssert((eicup->config->iccfgp[0] != NULL) &&
+                  (eicup->config->iccfgp[1] != NULL) &&
+                  (eicup->config->iccfgp[2] != NULL),
+                  "hall sensors need channels 1 to 3");
+
+    /* CR2_TI1S = 1, TI1 is the XOR of the CH1, CH2 and CH3 pins.*/
+    eicup->tim->CR2 = STM32_TIM_CR2_TI1S;
+
+    /* CCMR1_CC1S = 11 = CH1 Input on TRC.*/
+    eicup->tim->CCMR1 = STM32_TIM_CCMR1_CC1S(3);
+
+    /* SMCR_TS  = 100, input is TI1F_ED, both edges.
+       SMCR_SMS = 100, reset on each transition.*/
+    eicup->tim->SMCR = STM32_TIM_SMCR_TS(4) | STM32_TIM_SMCR_SMS(4);
+    eicup->tim->CCER = STM32_TIM_CCER_CC1E;
+
+    /* The capture is the time since the previous transition.*/
+    eicup->wccrp[0] = &eicup->tim->CCR[0];
+    eicup->pccrp    = &eicup->tim->CCR[0];
+#if EICU_USE_ENCODER
+  } else if (eicup->config->input_type == EICU_INPUT_ENCODER) {
+    osalDbgAssert((eicup->config->iccfgp[0] != NULL) &&
+                  (eicup->config->iccfgp[1] != NULL),
+                  "encoder needs channels 1 and 2");
+
+    /* CCMR1_CC1S = 01 = TI1FP1, CCMR1_CC2S = 01 = TI2FP2, no capture is
+       enabled, the polarity bits only select the counting sense.*/
+    eicup->tim->CCMR1 = STM32_TIM_CCMR1_CC1S(1) | STM32_TIM_CCMR1_CC2S(1);
+    if (eicup->config->iccfgp[0]->mode == EICU_INPUT_ACTIVE_LOW)
+      eicup->tim->CCER |= STM32_TIM_CCER_CC1P;
+    if (eicup->config->iccfgp[1]->mode == EICU_INPUT_ACTIVE_LOW)
+      eicup->tim->CCER |= STM32_TIM_CCER_CC2P;
+
+    /* SMCR_SMS = 001, 010 or 011, encoder modes.*/
+    eicup->tim->SMCR = STM32_TIM_SMCR_SMS(eicup->config->encoder);
+#endif
+  } else { /* EICU_INPUT_EDGE, EICU_INPUT_PULSE, EICU_INPUT_FREQUENCY,
+              EICU_INPUT_PWM_MULTI & EICU_INPUT_PPM */
 
     /* Set each input channel that is used as: a normal input capture channel,
        link the corresponding CCR register and set polarity. */
@@ -699,7 +1691,98 @@ void eicu_lld_start(EICUDriver *eicup) {
       else 
         eicup->tim->CCER |= STM32_TIM_CCER_CC4E | STM32_TIM_CCER_CC4P;
     }
+
+    /* Pulse engines that do not flip the polarity in the ISR.*/
+    if (eicu_lld_uses_pulse(eicup->config)) {
+      for (n = 0; n < 4; n++)
+        eicu_lld_config_pulse(eicup, n);
+    }
+  }
+
+  /* Synchronized start, the master outputs its counter enable on TRGO and
+     the slaves counters are enabled by it.*/
+  if (eicup->config->sync == EICU_SYNC_MASTER) {
+    /* The shared timebase must be monotonic, the master counter is not
+       reset by its inputs nor driven by an encoder.*/
+    osalDbgAssert((eicup->config->input_type != EICU_INPUT_PWM) &&
+                  (eicup->config->input_type != EICU_INPUT_HALL) &&
+                  (eicup->config->input_type != EICU_INPUT_ENCODER),
+                  "master counter not a timebase");
+    eicup->tim->CR2 |= STM32_TIM_CR2_MMS(1);
+  } else if (eicup->config->sync == EICU_SYNC_SLAVE) {
+    osalDbgAssert((eicup->config->input_type != EICU_INPUT_PWM) &&
+                  (eicup->config->input_type != EICU_INPUT_HALL) &&
+                  (eicup->config->input_type != EICU_INPUT_ENCODER),
+                  "slave controller already in use");
+    osalDbgAssert(eicup->config->sync_trigger <= 3, "invalid trigger");
+
+    /* SMCR_TS  = 0xx, input is ITRx.
+       SMCR_SMS = 110, trigger mode.*/
+    eicup->tim->SMCR = STM32_TIM_SMCR_TS(eicup->config->sync_trigger) |
+                       STM32_TIM_SMCR_SMS(6);
   }
+
+  /* Specialized handlers only serve the configuration they were compiled
+     for.*/
+#if STM32_EICU_USE_TIM1 && defined(STM32_EICU_TIM1_INPUT_TYPE)
+  if (&EICUD1 == eicup)
+    eicu_lld_check_fixed(eicup, STM32_EICU_TIM1_INPUT_TYPE,
+                         STM32_EICU_TIM1_CHANNELS);
+#endif
+#if STM32_EICU_USE_TIM2 && defined(STM32_EICU_TIM2_INPUT_TYPE)
+  if (&EICUD2 == eicup)
+    eicu_lld_check_fixed(eicup, STM32_EICU_TIM2_INPUT_TYPE,
+                         STM32_EICU_TIM2_CHANNELS);
+#endif
+#if STM32_EICU_USE_TIM3 && defined(STM32_EICU_TIM3_INPUT_TYPE)
+  if (&EICUD3 == eicup)
+    eicu_lld_check_fixed(eicup, STM32_EICU_TIM3_INPUT_TYPE,
+                         STM32_EICU_TIM3_CHANNELS);
+#endif
+#if STM32_EICU_USE_TIM4 && defined(STM32_EICU_TIM4_INPUT_TYPE)
+  if (&EICUD4 == eicup)
+    eicu_lld_check_fixed(eicup, STM32_EICU_TIM4_INPUT_TYPE,
+                         STM32_EICU_TIM4_CHANNELS);
+#endif
+#if STM32_EICU_USE_TIM5 && defined(STM32_EICU_TIM5_INPUT_TYPE)
+  if (&EICUD5 == eicup)
+    eicu_lld_check_fixed(eicup, STM32_EICU_TIM5_INPUT_TYPE,
+                         STM32_EICU_TIM5_CHANNELS);
+#endif
+#if STM32_EICU_USE_TIM8 && defined(STM32_EICU_TIM8_INPUT_TYPE)
+  if (&EICUD8 == eicup)
+    eicu_lld_check_fixed(eicup, STM32_EICU_TIM8_INPUT_TYPE,
+                         STM32_EICU_TIM8_CHANNELS);
+#endif
+#if STM32_EICU_USE_TIM9 && defined(STM32_EICU_TIM9_INPUT_TYPE)
+  if (&EICUD9 == eicup)
+    eicu_lld_check_fixed(eicup, STM32_EICU_TIM9_INPUT_TYPE,
+                         STM32_EICU_TIM9_CHANNELS);
+#endif
+#if STM32_EICU_USE_TIM12 && defined(STM32_EICU_TIM12_INPUT_TYPE)
+  if (&EICUD12 == eicup)
+    eicu_lld_check_fixed(eicup, STM32_EICU_TIM12_INPUT_TYPE,
+                         STM32_EICU_TIM12_CHANNELS);
+#endif
+
+  eicup->tmask = 0;
+  for (n = 0; n < 4; n++) {
+    eicup->channels[n].psc = 0;
+    eicu_lld_config_input(eicup, n);
+  }
+
+  eicup->input_type  = eicup->config->input_type;
+  eicup->overflow_cb = eicup->config->overflow_cb;
+  eicup->error_cb    = eicup->config->error_cb;
+  eicup->timeout_cb  = eicup->config->timeout_cb;
+  eicu_lld_resolve_dispatch(eicup);
+#if EICU_USE_TIMEBASE
+  eicu_lld_resolve_reference(eicup);
+#endif
+
+#if STM32_EICU_USE_DMA
+  eicu_lld_dma_allocate(eicup);
+#endif
 }
 
 /**
@@ -716,6 +1799,10 @@ void eicu_lld_stop(EICUDriver *eicup) {
     eicup->tim->DIER = 0;                     /* All IRQs disabled.           */
     eicup->tim->SR   = 0;                     /* Clear eventual pending IRQs. */
 
+#if STM32_EICU_USE_DMA
+    eicu_lld_dma_release(eicup);
+#endif
+
 #if STM32_EICU_USE_TIM1
     if (&EICUD1 == eicup) {
       nvicDisableVector(STM32_TIM1_UP_NUMBER);
@@ -777,41 +1864,130 @@ void eicu_lld_stop(EICUDriver *eicup) {
  * @notapi
  */
 void eicu_lld_enable(EICUDriver *eicup) {
+  size_t n;
+
   eicup->tim->EGR = STM32_TIM_EGR_UG;
   eicup->tim->SR = 0;                         /* Clear pending IRQs (if any). */
 
+  /* The counter restarts from zero, so does the extended timebase.*/
+  eicup->epoch = 0;
+  for (n = 0; n < 4; n++) {
+    eicup->channels[n].state  = EICU_WAITING;
+    eicup->channels[n].last   = 0;
+    eicup->channels[n].stamp  = 0;
+    eicup->channels[n].width  = 0;
+    eicup->channels[n].period = 0;
+    eicup->channels[n].silent = 0;
+    eicup->channels[n].pending = 0;
+    eicup->channels[n].icount  = 0;
+    eicup->channels[n].isum    = 0;
+#if EICU_USE_AGGREGATION
+    eicup->channels[n].acc.count = 0;
+    eicup->channels[n].agg.count = 0;
+#endif
+#if EICU_USE_DEADBAND
+    eicup->channels[n].db[EICU_DEADBAND_WIDTH].valid  = false;
+    eicup->channels[n].db[EICU_DEADBAND_PERIOD].valid = false;
+#endif
+  }
+#if EICU_USE_ENCODER
+  eicup->enc_pos  = 0;
+  eicup->enc_time = osalOsGetSystemTimeX();
+  eicup->enc_vel  = 0;
+#endif
+
   if (eicup->config->input_type == EICU_INPUT_PWM) {
+    /* The period capture is always served, it restarts the epoch.*/
     if (eicup->config->iccfgp[0] != NULL) {
-      if (eicup->config->period_cb != NULL)
-        eicup->tim->DIER |= STM32_TIM_DIER_CC1IE;
-      if ((eicup->config->iccfgp[EICU_CHANNEL_1] != NULL) &&
-          (eicup->config->iccfgp[EICU_CHANNEL_1]->width_cb != NULL))
+      eicup->tim->DIER |= STM32_TIM_DIER_CC1IE;
+      if (eicu_lld_is_served(eicup, EICU_CHANNEL_1))
         eicup->tim->DIER |= STM32_TIM_DIER_CC2IE;
     } else {
-      if ((eicup->config->iccfgp[EICU_CHANNEL_2] != NULL) &&
-          (eicup->config->iccfgp[EICU_CHANNEL_2]->width_cb != NULL))
+      if (eicu_lld_is_served(eicup, EICU_CHANNEL_2))
         eicup->tim->DIER |= STM32_TIM_DIER_CC1IE;
-      if (eicup->config->period_cb != NULL)
-        eicup->tim->DIER |= STM32_TIM_DIER_CC2IE;
+      eicup->tim->DIER |= STM32_TIM_DIER_CC2IE;
     }
-  } else { /* EICU_INPUT_PULSE & EICU_INPUT_EDGE */
-    if ((eicup->config->iccfgp[EICU_CHANNEL_1] != NULL) &&
-        (eicup->config->iccfgp[EICU_CHANNEL_1]->width_cb != NULL))
+  } else if (eicup->config->input_type == EICU_INPUT_HALL) {
+    /* The transitions are always served, they restart the epoch.*/
+    eicup->tim->DIER |= STM32_TIM_DIER_CC1IE;
+  } else { /* EICU_INPUT_PULSE, EICU_INPUT_EDGE, EICU_INPUT_FREQUENCY,
+              EICU_INPUT_PWM_MULTI & EICU_INPUT_PPM */
+    if (eicu_lld_is_served(eicup, EICU_CHANNEL_1))
       eicup->tim->DIER |= STM32_TIM_DIER_CC1IE;
-    if ((eicup->config->iccfgp[EICU_CHANNEL_2] != NULL) &&
-        eicup->config->iccfgp[EICU_CHANNEL_2]->width_cb != NULL)
+    if (eicu_lld_is_served(eicup, EICU_CHANNEL_2))
       eicup->tim->DIER |= STM32_TIM_DIER_CC2IE;
-    if ((eicup->config->iccfgp[EICU_CHANNEL_3] != NULL) &&
-        eicup->config->iccfgp[EICU_CHANNEL_3]->width_cb != NULL)
+    if (eicu_lld_is_served(eicup, EICU_CHANNEL_3))
       eicup->tim->DIER |= STM32_TIM_DIER_CC3IE;
-    if ((eicup->config->iccfgp[EICU_CHANNEL_4] != NULL) &&
-        eicup->config->iccfgp[EICU_CHANNEL_4]->width_cb != NULL)
+    if (eicu_lld_is_served(eicup, EICU_CHANNEL_4))
       eicup->tim->DIER |= STM32_TIM_DIER_CC4IE;
+
+    /* Paired pulse channels also need the stop edge capture.*/
+    if (eicu_lld_uses_pulse(eicup->config)) {
+      for (n = 0; n < 4; n++) {
+        if ((eicup->config->iccfgp[n] != NULL) &&
+            (eicup->config->iccfgp[n]->pulse == EICU_PULSE_PAIRED) &&
+            eicu_lld_is_served(eicup, (eicuchannel_t)n))
+          eicup->tim->DIER |= STM32_TIM_DIER_CC1IE << (n ^ 1);
+      }
+    }
+
+    /* Interval pairs need both edges, the start channel settings decide.*/
+    if (eicup->config->input_type == EICU_INPUT_INTERVAL) {
+      for (n = 0; n < 4; n += 2) {
+        if ((eicup->config->iccfgp[n + 1] != NULL) &&
+            eicu_lld_is_served(eicup, (eicuchannel_t)n))
+          eicup->tim->DIER |= (STM32_TIM_DIER_CC1IE |
+                               STM32_TIM_DIER_CC2IE) << n;
+        else
+          eicup->tim->DIER &= ~((STM32_TIM_DIER_CC1IE |
+                                 STM32_TIM_DIER_CC2IE) << n);
+      }
+    }
   }
-  if (eicup->config->overflow_cb != NULL)
+  /* The overflow interrupt maintains the extended timebase, a 32 bits
+     counter with 32 bits timestamps needs it only for the callback and
+     the input loss timeouts.*/
+  if ((eicu_lld_get_epoch_increment(eicup) != 0) ||
+      (eicup->config->overflow_cb != NULL) || (eicup->tmask != 0))
     eicup->tim->DIER |= STM32_TIM_DIER_UIE;
 
-  eicup->tim->CR1 = STM32_TIM_CR1_URS | STM32_TIM_CR1_CEN;
+#if STM32_EICU_USE_DMA
+  {
+    const EICU_IC_Settings *icp;
+
+    /* Channels in DMA capture mode raise DMA requests instead of IRQs.*/
+    for (n = 0; n < 4; n++) {
+      if (eicup->dma[n].dmastp == NULL)
+        continue;
+
+      icp = eicup->config->iccfgp[n];
+      dmaStreamSetMemory0(eicup->dma[n].dmastp, icp->dma_buffer);
+      dmaStreamSetTransactionSize(eicup->dma[n].dmastp, icp->dma_depth);
+      dmaStreamSetMode(eicup->dma[n].dmastp,
+                       STM32_DMA_CR_CHSEL(icp->dma_channel) |
+                       STM32_DMA_CR_PL(STM32_EICU_DMA_PRIORITY) |
+                       STM32_DMA_CR_DIR_P2M | STM32_DMA_CR_MINC |
+                       STM32_DMA_CR_CIRC | STM32_DMA_CR_HTIE |
+                       STM32_DMA_CR_TCIE | STM32_DMA_CR_TEIE |
+                       STM32_DMA_CR_DMEIE |
+                       (sizeof (eicucnt_t) == 4 ?
+                        STM32_DMA_CR_PSIZE_WORD | STM32_DMA_CR_MSIZE_WORD :
+                        STM32_DMA_CR_PSIZE_HWORD | STM32_DMA_CR_MSIZE_HWORD));
+      dmaStreamEnable(eicup->dma[n].dmastp);
+
+      eicup->tim->DIER &= ~(STM32_TIM_DIER_CC1IE << n);
+      eicup->tim->DIER |= STM32_TIM_DIER_CC1DE << n;
+    }
+  }
+#endif
+
+  eicup->irqmask = eicup->tim->DIER & STM32_TIM_DIER_IRQ_MASK;
+
+  /* A slave counter is armed, its master enable starts it.*/
+  if (eicup->config->sync == EICU_SYNC_SLAVE)
+    eicup->tim->CR1 = STM32_TIM_CR1_URS;
+  else
+    eicup->tim->CR1 = STM32_TIM_CR1_URS | STM32_TIM_CR1_CEN;
 }
 
 /**
@@ -827,34 +2003,108 @@ void eicu_lld_disable(EICUDriver *eicup) {
 
   /* All interrupts disabled.*/
   eicup->tim->DIER &= ~STM32_TIM_DIER_IRQ_MASK;
+  eicup->irqmask    = 0;
+
+#if STM32_EICU_USE_DMA
+  {
+    size_t n;
+
+    for (n = 0; n < 4; n++) {
+      if (eicup->dma[n].dmastp != NULL) {
+        eicup->tim->DIER &= ~(STM32_TIM_DIER_CC1DE << n);
+        dmaStreamDisable(eicup->dma[n].dmastp);
+      }
+    }
+  }
+#endif
 }
 
+#if EICU_USE_ENCODER || defined(__DOXYGEN__)
 /**
- * @brief   Returns the width of the latest pulse.
- * @details The pulse width is defined as number of ticks between the start
- *          edge and the stop edge.
+ * @brief   Returns the extended position of an encoder.
+ * @details Lock-free, the counter is read again if an overflow was served
+ *          or flagged meanwhile. An overflow flagged but not yet served is
+ *          accounted here.
  *
- * @param[in] eicup     Pointer to the EICUDriver object.
- * @param[in] channel   The timer channel that fired the interrupt.
- * @return              The number of ticks.
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @return              The position in counts.
  *
  * @notapi
  */
-uint16_t eicu_lld_get_width(EICUDriver *eicup, uint16_t channel) {
-  uint16_t capture, last_count;
-  capture = eicu_lld_get_compare(eicup, channel);
+int32_t eicu_lld_get_position(EICUDriver *eicup) {
+  volatile eicutstamp_t *epochp = &eicup->epoch;
+  eicutstamp_t epoch;
+  eicucnt_t cnt;
+  uint32_t uif;
+
+  do {
+    epoch = *epochp;
+    uif   = eicup->tim->SR & STM32_TIM_SR_UIF;
+    cnt   = (eicucnt_t)eicup->tim->CNT;
+  } while ((epoch != *epochp) ||
+           (uif != (eicup->tim->SR & STM32_TIM_SR_UIF)));
+
+  if (uif != 0) {
+    if (cnt <= (eicu_lld_get_top(eicup) >> 1))
+      epoch += eicu_lld_get_epoch_increment(eicup);
+    else
+      epoch -= eicu_lld_get_epoch_increment(eicup);
+  }
 
-  /* Add code to compensate for overflows when in pulse */
-  if (eicup->config->input_type == EICU_INPUT_PULSE) {
-    last_count = eicup->last_count[channel];
+  return (int32_t)(epoch + cnt);
+}
 
-    if (capture > last_count)       /* No overflow */
-      capture = capture - last_count;
-    else if (capture < last_count)  /* Timer overflow */
-      capture = ((0xFFFF - last_count) + capture); 
+/**
+ * @brief   Returns the velocity of an encoder.
+ * @details At speed the position changes between two calls and the
+ *          velocity is the change over the system time interval. At low
+ *          speed the interval is stretched up to the next change, while no
+ *          change is seen the estimate is bounded by one count over the
+ *          elapsed time, it drops to zero after @p encoder_stop.
+ * @note    In encoder mode the timer counts the encoder edges, it has no
+ *          capture timestamps, so the interval is measured in system ticks
+ *          and has their resolution. The caller keeps the interval long
+ *          enough for the accuracy it needs.
+ * @note    The interval is rebased once the encoder is stopped, so only
+ *          the time between two calls has to stay within the system time
+ *          range.
+ *
+ * @param[in] eicup     Pointer to the @p EICUDriver object
+ * @return              The velocity in counts per second.
+ *
+ * @notapi
+ */
+int32_t eicu_lld_get_velocity(EICUDriver *eicup) {
+  systime_t now = osalOsGetSystemTimeX();
+  systime_t dt  = (systime_t)(now - eicup->enc_time);
+  int32_t pos = eicu_lld_get_position(eicup);
+  int32_t bound;
+
+  if (dt == 0)
+    return eicup->enc_vel;
+
+  if (pos != eicup->enc_pos) {
+    /* 64 bits difference, a 32 bits counter can span the whole range.*/
+    eicup->enc_vel  = (int32_t)((((int64_t)pos - (int64_t)eicup->enc_pos) *
+                                 OSAL_ST_FREQUENCY) / (int64_t)dt);
+    eicup->enc_pos  = pos;
+    eicup->enc_time = now;
+  }
+  else if (dt >= eicup->config->encoder_stop) {
+    /* Stopped, the interval restarts so that it never wraps while idle.*/
+    eicup->enc_vel  = 0;
+    eicup->enc_time = now;
+  }
+  else {
+    bound = (int32_t)(OSAL_ST_FREQUENCY / dt);
+    if (eicup->enc_vel > bound)
+      eicup->enc_vel = bound;
+    else if (eicup->enc_vel < -bound)
+      eicup->enc_vel = -bound;
   }
 
-  return capture;
+  return eicup->enc_vel;
 }
+#endif /* EICU_USE_ENCODER */
 
 #endif /* HAL_USE_EICU */
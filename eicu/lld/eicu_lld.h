@@ -29,6 +29,16 @@
 /* Driver constants.                                                         */
 /*===========================================================================*/
 
+/**
+ * @brief   Counter top value of the 16 bits timers.
+ */
+#define EICU_LLD_TOP_16BITS                  0xFFFFU
+
+/**
+ * @brief   Counter top value of the 32 bits timers.
+ */
+#define EICU_LLD_TOP_32BITS                  0xFFFFFFFFU
+
 /*===========================================================================*/
 /* Driver pre-compile time settings.                                         */
 /*===========================================================================*/
@@ -164,6 +174,191 @@
 #if !defined(STM32_EICU_TIM12_IRQ_PRIORITY) || defined(__DOXYGEN__)
 #define STM32_EICU_TIM12_IRQ_PRIORITY        7
 #endif
+
+/**
+ * @brief   EICUD1 fixed input type.
+ * @details If defined the TIM1 interrupt handler is compiled for this
+ *          input type and the channels in @p STM32_EICU_TIM1_CHANNELS
+ *          only, @p eicuStart() then rejects any other configuration.
+ * @note    Not defined by default, the handler serves any configuration.
+ */
+#if defined(__DOXYGEN__)
+#define STM32_EICU_TIM1_INPUT_TYPE           EICU_INPUT_EDGE
+#endif
+
+/**
+ * @brief   EICUD1 fixed channels, channel 1 in bit 0.
+ * @note    Only used with @p STM32_EICU_TIM1_INPUT_TYPE.
+ */
+#if !defined(STM32_EICU_TIM1_CHANNELS) || defined(__DOXYGEN__)
+#define STM32_EICU_TIM1_CHANNELS             0x0FU
+#endif
+
+/**
+ * @brief   EICUD2 fixed input type.
+ * @details If defined the TIM2 interrupt handler is compiled for this
+ *          input type and the channels in @p STM32_EICU_TIM2_CHANNELS
+ *          only, @p eicuStart() then rejects any other configuration.
+ * @note    Not defined by default, the handler serves any configuration.
+ */
+#if defined(__DOXYGEN__)
+#define STM32_EICU_TIM2_INPUT_TYPE           EICU_INPUT_EDGE
+#endif
+
+/**
+ * @brief   EICUD2 fixed channels, channel 1 in bit 0.
+ * @note    Only used with @p STM32_EICU_TIM2_INPUT_TYPE.
+ */
+#if !defined(STM32_EICU_TIM2_CHANNELS) || defined(__DOXYGEN__)
+#define STM32_EICU_TIM2_CHANNELS             0x0FU
+#endif
+
+/**
+ * @brief   EICUD3 fixed input type.
+ * @details If defined the TIM3 interrupt handler is compiled for this
+ *          input type and the channels in @p STM32_EICU_TIM3_CHANNELS
+ *          only, @p eicuStart() then rejects any other configuration.
+ * @note    Not defined by default, the handler serves any configuration.
+ */
+#if defined(__DOXYGEN__)
+#define STM32_EICU_TIM3_INPUT_TYPE           EICU_INPUT_EDGE
+#endif
+
+/**
+ * @brief   EICUD3 fixed channels, channel 1 in bit 0.
+ * @note    Only used with @p STM32_EICU_TIM3_INPUT_TYPE.
+ */
+#if !defined(STM32_EICU_TIM3_CHANNELS) || defined(__DOXYGEN__)
+#define STM32_EICU_TIM3_CHANNELS             0x0FU
+#endif
+
+/**
+ * @brief   EICUD4 fixed input type.
+ * @details If defined the TIM4 interrupt handler is compiled for this
+ *          input type and the channels in @p STM32_EICU_TIM4_CHANNELS
+ *          only, @p eicuStart() then rejects any other configuration.
+ * @note    Not defined by default, the handler serves any configuration.
+ */
+#if defined(__DOXYGEN__)
+#define STM32_EICU_TIM4_INPUT_TYPE           EICU_INPUT_EDGE
+#endif
+
+/**
+ * @brief   EICUD4 fixed channels, channel 1 in bit 0.
+ * @note    Only used with @p STM32_EICU_TIM4_INPUT_TYPE.
+ */
+#if !defined(STM32_EICU_TIM4_CHANNELS) || defined(__DOXYGEN__)
+#define STM32_EICU_TIM4_CHANNELS             0x0FU
+#endif
+
+/**
+ * @brief   EICUD5 fixed input type.
+ * @details If defined the TIM5 interrupt handler is compiled for this
+ *          input type and the channels in @p STM32_EICU_TIM5_CHANNELS
+ *          only, @p eicuStart() then rejects any other configuration.
+ * @note    Not defined by default, the handler serves any configuration.
+ */
+#if defined(__DOXYGEN__)
+#define STM32_EICU_TIM5_INPUT_TYPE           EICU_INPUT_EDGE
+#endif
+
+/**
+ * @brief   EICUD5 fixed channels, channel 1 in bit 0.
+ * @note    Only used with @p STM32_EICU_TIM5_INPUT_TYPE.
+ */
+#if !defined(STM32_EICU_TIM5_CHANNELS) || defined(__DOXYGEN__)
+#define STM32_EICU_TIM5_CHANNELS             0x0FU
+#endif
+
+/**
+ * @brief   EICUD8 fixed input type.
+ * @details If defined the TIM8 interrupt handler is compiled for this
+ *          input type and the channels in @p STM32_EICU_TIM8_CHANNELS
+ *          only, @p eicuStart() then rejects any other configuration.
+ * @note    Not defined by default, the handler serves any configuration.
+ */
+#if defined(__DOXYGEN__)
+#define STM32_EICU_TIM8_INPUT_TYPE           EICU_INPUT_EDGE
+#endif
+
+/**
+ * @brief   EICUD8 fixed channels, channel 1 in bit 0.
+ * @note    Only used with @p STM32_EICU_TIM8_INPUT_TYPE.
+ */
+#if !defined(STM32_EICU_TIM8_CHANNELS) || defined(__DOXYGEN__)
+#define STM32_EICU_TIM8_CHANNELS             0x0FU
+#endif
+
+/**
+ * @brief   EICUD9 fixed input type.
+ * @details If defined the TIM9 interrupt handler is compiled for this
+ *          input type and the channels in @p STM32_EICU_TIM9_CHANNELS
+ *          only, @p eicuStart() then rejects any other configuration.
+ * @note    Not defined by default, the handler serves any configuration.
+ */
+#if defined(__DOXYGEN__)
+#define STM32_EICU_TIM9_INPUT_TYPE           EICU_INPUT_EDGE
+#endif
+
+/**
+ * @brief   EICUD9 fixed channels, channel 1 in bit 0.
+ * @note    Only used with @p STM32_EICU_TIM9_INPUT_TYPE.
+ */
+#if !defined(STM32_EICU_TIM9_CHANNELS) || defined(__DOXYGEN__)
+#define STM32_EICU_TIM9_CHANNELS             0x0FU
+#endif
+
+/**
+ * @brief   EICUD12 fixed input type.
+ * @details If defined the TIM12 interrupt handler is compiled for this
+ *          input type and the channels in @p STM32_EICU_TIM12_CHANNELS
+ *          only, @p eicuStart() then rejects any other configuration.
+ * @note    Not defined by default, the handler serves any configuration.
+ */
+#if defined(__DOXYGEN__)
+#define STM32_EICU_TIM12_INPUT_TYPE          EICU_INPUT_EDGE
+#endif
+
+/**
+ * @brief   EICUD12 fixed channels, channel 1 in bit 0.
+ * @note    Only used with @p STM32_EICU_TIM12_INPUT_TYPE.
+ */
+#if !defined(STM32_EICU_TIM12_CHANNELS) || defined(__DOXYGEN__)
+#define STM32_EICU_TIM12_CHANNELS            0x0FU
+#endif
+
+/**
+ * @brief   Enables the DMA capture mode.
+ * @details If set to @p TRUE the channels that specify a DMA buffer in their
+ *          @p EICU_IC_Settings stream the captured values into a circular
+ *          buffer using the timer CC DMA requests, the CPU is only involved
+ *          on half and full buffer events.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(STM32_EICU_USE_DMA) || defined(__DOXYGEN__)
+#define STM32_EICU_USE_DMA                   FALSE
+#endif
+
+/**
+ * @brief   EICU DMA streams priority level setting.
+ */
+#if !defined(STM32_EICU_DMA_PRIORITY) || defined(__DOXYGEN__)
+#define STM32_EICU_DMA_PRIORITY              2
+#endif
+
+/**
+ * @brief   EICU DMA streams interrupt priority level setting.
+ */
+#if !defined(STM32_EICU_DMA_IRQ_PRIORITY) || defined(__DOXYGEN__)
+#define STM32_EICU_DMA_IRQ_PRIORITY          7
+#endif
+
+/**
+ * @brief   EICU DMA error hook.
+ */
+#if !defined(STM32_EICU_DMA_ERROR_HOOK) || defined(__DOXYGEN__)
+#define STM32_EICU_DMA_ERROR_HOOK(eicup)     osalSysHalt("DMA failure")
+#endif
 /** @} */
 
 /*===========================================================================*/
@@ -249,6 +444,32 @@
 #error "Invalid IRQ priority assigned to TIM12"
 #endif
 
+#if STM32_EICU_USE_DMA && !STM32_ADVANCED_DMA
+#error "EICU DMA mode requires a DMA controller with request selection"
+#endif
+
+#if STM32_EICU_USE_DMA &&                                                    \
+    !OSAL_IRQ_IS_VALID_PRIORITY(STM32_EICU_DMA_IRQ_PRIORITY)
+#error "Invalid IRQ priority assigned to EICU DMA streams"
+#endif
+
+#if STM32_EICU_USE_DMA &&                                                    \
+    !STM32_DMA_IS_VALID_PRIORITY(STM32_EICU_DMA_PRIORITY)
+#error "Invalid DMA priority assigned to EICU DMA streams"
+#endif
+
+/**
+ * @brief   At least one enabled timer has a 32 bits counter.
+ * @details Only then the counter type and the overflow arithmetic are
+ *          widened, else the 16 bits timers keep their constant range.
+ */
+#if (STM32_EICU_USE_TIM2 && STM32_TIM2_IS_32BITS) ||                          \
+    (STM32_EICU_USE_TIM5 && STM32_TIM5_IS_32BITS) || defined(__DOXYGEN__)
+#define STM32_EICU_HAS_32BIT_TIMERS          TRUE
+#else
+#define STM32_EICU_HAS_32BIT_TIMERS          FALSE
+#endif
+
 /*===========================================================================*/
 /* Driver data structures and types.                                         */
 /*===========================================================================*/
@@ -267,6 +488,84 @@ typedef enum {
   EICU_INPUT_ACTIVE_LOW = 1,
 } eicumode_t;
 
+/**
+ * @brief   Input capture prescaler.
+ */
+typedef enum {
+  /**
+   * @brief   Capture on every edge.
+   */
+  EICU_PSC_1 = 0,
+  /**
+   * @brief   Capture once every 2 edges.
+   */
+  EICU_PSC_2 = 1,
+  /**
+   * @brief   Capture once every 4 edges.
+   */
+  EICU_PSC_4 = 2,
+  /**
+   * @brief   Capture once every 8 edges.
+   */
+  EICU_PSC_8 = 3
+} eicupsc_t;
+
+/**
+ * @brief   Encoder counting mode, SMCR SMS field value.
+ */
+typedef enum {
+  /**
+   * @brief   Counts the TI2 edges, two counts per cycle.
+   */
+  EICU_ENCODER_TI2 = 1,
+  /**
+   * @brief   Counts the TI1 edges, two counts per cycle.
+   */
+  EICU_ENCODER_TI1 = 2,
+  /**
+   * @brief   Counts the edges of both inputs, four counts per cycle.
+   */
+  EICU_ENCODER_BOTH = 3
+} eicuencoder_t;
+
+/**
+ * @brief   Timer synchronization role.
+ */
+typedef enum {
+  /**
+   * @brief   The timer starts on its own.
+   */
+  EICU_SYNC_NONE = 0,
+  /**
+   * @brief   The timer start is output on TRGO.
+   */
+  EICU_SYNC_MASTER = 1,
+  /**
+   * @brief   The timer starts on the TRGO of a master, through an ITRx.
+   */
+  EICU_SYNC_SLAVE = 2
+} eicusync_t;
+
+/**
+ * @brief   Pulse measurement engine selector.
+ */
+typedef enum {
+  /**
+   * @brief   Inverts the channel polarity in the ISR on each edge.
+   */
+  EICU_PULSE_POLARITY_FLIP = 0,
+  /**
+   * @brief   Captures both edges, the polarity is sampled from the pin.
+   * @note    Requires the @p port and @p pad of the input.
+   */
+  EICU_PULSE_BOTH_EDGES = 1,
+  /**
+   * @brief   The neighbour channel captures the stop edge of the same input.
+   * @note    The neighbour channel (1-2, 3-4) must be unused.
+   */
+  EICU_PULSE_PAIRED = 2
+} eicupulse_t;
+
 /**
  * @brief   Input type selector.
  */
@@ -282,7 +581,41 @@ typedef enum {
   /**
    * @brief   Triggers on detected PWM period and width.
    */
-  EICU_INPUT_PWM = 2
+  EICU_INPUT_PWM = 2,
+  /**
+   * @brief   Counts edges over a gate time, reciprocal frequency counter.
+   */
+  EICU_INPUT_FREQUENCY = 3,
+  /**
+   * @brief   Free-running PWM period and width on every channel.
+   * @details Edges are captured by the pulse engines, the period is the
+   *          time between two start edges of the same channel.
+   */
+  EICU_INPUT_PWM_MULTI = 4,
+  /**
+   * @brief   Decodes PPM frames, one channel per timer.
+   * @note    Requires @p EICU_USE_PPM.
+   */
+  EICU_INPUT_PPM = 5,
+  /**
+   * @brief   Quadrature encoder on channels 1 and 2, no capture interrupt.
+   * @note    Requires @p EICU_USE_ENCODER, not available on TIM9 and TIM12.
+   */
+  EICU_INPUT_ENCODER = 6,
+  /**
+   * @brief   Hall sensors on channels 1 to 3, XORed on TI1 with slave reset.
+   * @details One commutation period per transition, reported through
+   *          @p period_cb, along with the hall state sampled in the ISR.
+   * @note    Not available on TIM9 and TIM12.
+   */
+  EICU_INPUT_HALL = 7,
+  /**
+   * @brief   Start to stop interval, channel 1 to channel 2 and channel 3 to
+   *          channel 4.
+   * @details One report per pair of edges, through the @p width_cb of the
+   *          start channel.
+   */
+  EICU_INPUT_INTERVAL = 8
 } eicuinput_t;
 
 /**
@@ -292,8 +625,26 @@ typedef uint32_t eicufreq_t;
 
 /**
  * @brief   EICU counter type.
+ * @note    It is 32 bits wide only if a 32 bits timer is in use.
  */
+#if STM32_EICU_HAS_32BIT_TIMERS || defined(__DOXYGEN__)
+typedef uint32_t eicucnt_t;
+#else
 typedef uint16_t eicucnt_t;
+#endif
+
+#if STM32_EICU_USE_DMA || defined(__DOXYGEN__)
+/**
+ * @brief EICU DMA buffer notification callback type.
+ *
+ * @param[in] eicup     Pointer to a EICUDriver object
+ * @param[in] channel   EICU channel owning the buffer
+ * @param[in] buffer    Pointer to the filled half of the circular buffer
+ * @param[in] n         Number of captured values in @p buffer
+ */
+typedef void (*eicudmacallback_t)(EICUDriver *eicup, eicuchannel_t channel,
+                                  const eicucnt_t *buffer, size_t n);
+#endif
 
 /** 
  * @brief EICU Input Capture Settings structure definition.  
@@ -309,6 +660,166 @@ typedef struct
    *          normal capture event.
    */
   eicucallback_t width_cb;
+#if STM32_EICU_USE_DMA || defined(__DOXYGEN__)
+  /**
+   * @brief   Circular capture buffer for DMA capture mode.
+   * @note    A NULL parameter selects the interrupt per edge capture, else
+   *          the channel captures edges into the buffer without invoking
+   *          @p width_cb. Only valid in @p EICU_INPUT_EDGE mode.
+   */
+  eicucnt_t *dma_buffer;
+  /**
+   * @brief   Number of entries in @p dma_buffer, must be even.
+   */
+  size_t dma_depth;
+  /**
+   * @brief   DMA stream serving the CC request of this channel.
+   * @note    Specified using @p STM32_DMA_STREAM_ID().
+   */
+  uint32_t dma_stream;
+  /**
+   * @brief   DMA request channel of the CC request of this channel.
+   */
+  uint32_t dma_channel;
+  /**
+   * @brief   Half and full buffer event callback.
+   */
+  eicudmacallback_t dma_cb;
+#endif
+  /**
+   * @brief   Pulse measurement engine.
+   * @note    Only used in @p EICU_INPUT_PULSE and @p EICU_INPUT_PWM_MULTI
+   *          modes.
+   */
+  eicupulse_t pulse;
+  /**
+   * @brief   Port of the input pin, for @p EICU_PULSE_BOTH_EDGES and
+   *          @p EICU_INPUT_HALL.
+   */
+  ioportid_t port;
+  /**
+   * @brief   Pad of the input pin, for @p EICU_PULSE_BOTH_EDGES and
+   *          @p EICU_INPUT_HALL.
+   */
+  uint8_t pad;
+  /**
+   * @brief   Input capture prescaler.
+   * @note    Only allowed in @p EICU_INPUT_EDGE and @p EICU_INPUT_FREQUENCY
+   *          modes. In edge mode the reported width and period are scaled
+   *          back to a single input cycle.
+   */
+  eicupsc_t prescaler;
+  /**
+   * @brief   Input digital filter, ICxF field value (0...15).
+   * @note    In PWM mode it is the filter of the selected input.
+   */
+  uint8_t filter;
+  /**
+   * @brief   Minimum gate time in ticks, for @p EICU_INPUT_FREQUENCY.
+   * @details The gate is closed by the first edge after this time, so it
+   *          always spans a whole number of input cycles.
+   */
+  eicutstamp_t gate;
+  /**
+   * @brief   Intervals averaged per report, for @p EICU_INPUT_INTERVAL.
+   * @note    Zero or one reports each interval, only the start channel
+   *          setting is used.
+   */
+  uint32_t interval_avg;
+#if EICU_USE_PPM || defined(__DOXYGEN__)
+  /**
+   * @brief   Minimum gap in ticks ending a PPM frame.
+   */
+  eicutstamp_t ppm_sync;
+  /**
+   * @brief   Minimum valid PPM channel value in ticks.
+   */
+  eicutstamp_t ppm_min;
+  /**
+   * @brief   Maximum valid PPM channel value in ticks.
+   */
+  eicutstamp_t ppm_max;
+  /**
+   * @brief   Expected number of channels per PPM frame, zero for any.
+   */
+  uint8_t ppm_channels;
+#endif
+  /**
+   * @brief   Input loss timeout in ticks, zero to disable.
+   * @details The channel is reported through @p timeout_cb when no edge
+   *          was captured for this time, then it waits for a new first
+   *          edge.
+   * @note    The timeout is checked on counter overflows, so it is rounded
+   *          up to whole counter periods and expires up to one more counter
+   *          period late. It cannot be shorter than one counter period,
+   *          that is 65536 ticks, or 2^32 ticks on the 32 bits TIM2 and
+   *          TIM5, which then need @p EICU_USE_64BIT_TIMESTAMPS.
+   * @note    Only edges captured on this channel re-arm it, the stop edges
+   *          of an interval pair do not.
+   * @note    Not available for channels in DMA capture mode.
+   */
+  eicutstamp_t timeout;
+#if EICU_USE_AGGREGATION || defined(__DOXYGEN__)
+  /**
+   * @brief   Widths per aggregation window, zero for no limit.
+   */
+  uint32_t agg_samples;
+  /**
+   * @brief   Duration of an aggregation window in ticks, zero for no limit.
+   * @note    A window is only closed by a measurement, so it can last
+   *          longer if the input stops.
+   * @note    With both limits at zero every width is reported.
+   */
+  eicutstamp_t agg_ticks;
+#endif
+#if EICU_USE_DEADBAND || defined(__DOXYGEN__)
+  /**
+   * @brief   Width deadband in ticks, zero to not compare the width.
+   * @details A measurement is only reported if its width or its period
+   *          moved by more than their deadband since the latest reported
+   *          one. With both deadbands at zero every measurement is
+   *          reported.
+   * @note    Choose the values meaningful for the input type, e.g. only
+   *          the period for @p EICU_INPUT_FREQUENCY where the width is the
+   *          gate span.
+   * @note    The snapshot and the aggregation window get every
+   *          measurement, the deadband only filters the reports.
+   */
+  eicutstamp_t deadband_width;
+  /**
+   * @brief   Period deadband in ticks, zero to not compare the period.
+   */
+  eicutstamp_t deadband_period;
+  /**
+   * @brief   Maximum time in ticks between two reports of a steady input,
+   *          zero for no limit.
+   * @note    It is checked on measurements, a stopped input is detected
+   *          by @p timeout instead.
+   * @note    In PWM modes the width and period events are reported and
+   *          refreshed independently of each other.
+   */
+  eicutstamp_t deadband_refresh;
+#endif
+#if EICU_USE_TIMEBASE || defined(__DOXYGEN__)
+  /**
+   * @brief   Reference period in microseconds, zero for a normal channel.
+   * @details A reference channel captures one edge per period of a known
+   *          signal, usually a GNSS 1PPS, to measure the timer clock.
+   * @note    Only in @p EICU_INPUT_EDGE, @p EICU_INPUT_FREQUENCY,
+   *          @p EICU_INPUT_PULSE and @p EICU_INPUT_PWM_MULTI modes, with
+   *          the @p EICU_PULSE_POLARITY_FLIP engine and no prescaler.
+   * @note    Periods off by more than about 1000 ppm from the current
+   *          estimate are rejected as glitches or missed edges.
+   * @note    A reference channel is always captured, @p width_cb is
+   *          optional.
+   */
+  uint32_t ref_period;
+  /**
+   * @brief   Timebase filter, each period corrects the estimate by
+   *          1/2^ref_filter of its error.
+   */
+  uint8_t ref_filter;
+#endif
 } EICU_IC_Settings;
 
 /** 
@@ -328,11 +839,16 @@ typedef struct
    * @brief   Pointer to each Input Capture channel configuration.
    * @note    A NULL parameter indicates the channel as unused. 
    * @note    In PWM mode, only Channel 1 OR Channel 2 may be used.
+   * @note    In multi-channel PWM mode all channels may be used, except
+   *          the neighbour of a @p EICU_PULSE_PAIRED channel.
    */
   const EICU_IC_Settings *iccfgp[4];
   /**
    * @brief   Period capture event callback. 
    * @note    Only used when in PWM measuremtent mode
+   * @note    In multi-channel PWM mode it is invoked on each start edge
+   *          with the channel that completed a cycle, through the period
+   *          deadband.
    */
   eicucallback_t period_cb;
   /**
@@ -343,8 +859,287 @@ typedef struct
    * @brief   TIM DIER register initialization data.
    */
   uint32_t                  dier;
+  /**
+   * @brief   Overcapture event callback.
+   * @note    Invoked with the channel that lost at least one edge, before
+   *          the capture itself is served.
+   */
+  eicucallback_t error_cb;
+#if EICU_USE_QUEUE || defined(__DOXYGEN__)
+  /**
+   * @brief   Capture queue buffer.
+   * @note    A NULL parameter disables the queue for this driver.
+   */
+  EICUCapture *queue_buffer;
+  /**
+   * @brief   Number of records in @p queue_buffer, must be a power of two.
+   */
+  size_t queue_size;
+#endif
+  /**
+   * @brief   Input loss callback, can be @p NULL.
+   * @note    Invoked with the channel whose @p timeout expired.
+   */
+  eicucallback_t timeout_cb;
+  /**
+   * @brief   Synchronization role of the timer.
+   * @note    Neither a master nor a slave can use a mode needing the slave
+   *          controller, that is @p EICU_INPUT_PWM, @p EICU_INPUT_HALL or
+   *          @p EICU_INPUT_ENCODER. A slave needs it for the trigger, and a
+   *          master counter reset by its input is not a shared timebase.
+   * @note    The master and its slaves must run at the same frequency with
+   *          the same counter width to share a timebase.
+   * @note    A slave only counts from a master start, it can only be enabled
+   *          by @p eicuEnableSynchronized() together with its master.
+   */
+  eicusync_t sync;
+  /**
+   * @brief   Internal trigger of a slave connected to the master TRGO, x in
+   *          ITRx (0...3).
+   * @note    See the internal trigger connection table of the timers in the
+   *          device reference manual.
+   */
+  uint8_t sync_trigger;
+#if EICU_USE_ENCODER || defined(__DOXYGEN__)
+  /**
+   * @brief   Encoder counting mode.
+   * @note    In encoder mode the channels 1 and 2 settings select the
+   *          input polarities and filters, @p frequency is not used.
+   */
+  eicuencoder_t encoder;
+  /**
+   * @brief   System ticks without a count after which the encoder velocity
+   *          is zero.
+   */
+  systime_t encoder_stop;
+#endif
 } EICUConfig;
 
+#if STM32_EICU_USE_DMA || defined(__DOXYGEN__)
+/**
+ * @brief EICU DMA capture channel structure definition.
+ */
+typedef struct
+{
+  /**
+   * @brief   Driver owning the channel, used from the DMA interrupt.
+   */
+  EICUDriver *eicup;
+  /**
+   * @brief   Channel number.
+   */
+  eicuchannel_t channel;
+  /**
+   * @brief   Allocated DMA stream or NULL if not in DMA capture mode.
+   */
+  const stm32_dma_stream_t *dmastp;
+  /**
+   * @brief   Capture buffer copied from the settings.
+   */
+  const eicucnt_t *buffer;
+  /**
+   * @brief   Half of the capture buffer depth.
+   */
+  size_t half;
+  /**
+   * @brief   Half buffer callback copied from the settings.
+   */
+  eicudmacallback_t cb;
+} EICUDMAChannel;
+#endif
+
+/**
+ * @brief EICU channel run-time data structure definition.
+ */
+typedef struct
+{
+  /**
+   * @brief   Capture state machine of the channel.
+   */
+  eicustate_t state;
+  /**
+   * @brief   Input capture prescaler, as a power of two.
+   */
+  uint8_t psc;
+  /**
+   * @brief   Pin level at a start edge, for pin sampled pulse capture.
+   */
+  uint8_t level;
+  /**
+   * @brief   Pad of the input pin, for pin sampled pulse capture and hall
+   *          sampling.
+   */
+  uint8_t pad;
+  /**
+   * @brief   Port of the input pin, for pin sampled pulse capture and hall
+   *          sampling.
+   */
+  ioportid_t port;
+  /**
+   * @brief   Gate time copied from the settings, for frequency capture.
+   */
+  eicutstamp_t gate;
+  /**
+   * @brief   Intervals per report copied from the settings.
+   */
+  uint32_t navg;
+  /**
+   * @brief   Extended timestamp of the latest start edge.
+   */
+  eicutstamp_t last;
+  /**
+   * @brief   Extended timestamp of the start edge before @p last.
+   */
+  eicutstamp_t prev;
+  /**
+   * @brief   Extended timestamp of the latest measurement.
+   */
+  eicutstamp_t stamp;
+  /**
+   * @brief   Latest measured width.
+   */
+  eicutstamp_t width;
+  /**
+   * @brief   Latest measured period.
+   */
+  eicutstamp_t period;
+  /**
+   * @brief   Edges counted in the open gate, for frequency capture.
+   */
+  uint32_t edges;
+  /**
+   * @brief   Edges counted in the latest closed gate, for frequency capture.
+   */
+  uint32_t count;
+#if EICU_USE_SNAPSHOTS || defined(__DOXYGEN__)
+  /**
+   * @brief   Snapshot sequence counter, odd during an update.
+   */
+  volatile uint32_t seq;
+  /**
+   * @brief   Snapshot of the latest published measurement.
+   */
+  EICUSnapshot snapshot;
+#endif
+  /**
+   * @brief   Edges of the open interval pair, start in bit 0 and stop in
+   *          bit 1.
+   */
+  uint8_t pending;
+  /**
+   * @brief   Intervals accumulated for the average.
+   */
+  uint32_t icount;
+  /**
+   * @brief   Sum of the accumulated intervals.
+   */
+  int64_t isum;
+  /**
+   * @brief   Latest average interval in 1/256 ticks.
+   */
+  eicuinterval_t iavg;
+  /**
+   * @brief   Counter overflows without any capture.
+   */
+  uint32_t silent;
+  /**
+   * @brief   Counter overflows without any capture expiring the timeout.
+   */
+  uint32_t tlimit;
+#if EICU_USE_AGGREGATION || defined(__DOXYGEN__)
+  /**
+   * @brief   Timestamp of the first width of the open window.
+   */
+  eicutstamp_t agg_start;
+  /**
+   * @brief   Aggregation of the open window.
+   */
+  EICUAggregate acc;
+  /**
+   * @brief   Aggregation of the latest closed window.
+   */
+  EICUAggregate agg;
+  /**
+   * @brief   Widths per window copied from the settings.
+   */
+  uint32_t agg_samples;
+  /**
+   * @brief   Window duration copied from the settings.
+   */
+  eicutstamp_t agg_ticks;
+#endif
+#if EICU_USE_DEADBAND || defined(__DOXYGEN__)
+  /**
+   * @brief   Width deadband copied from the settings.
+   */
+  eicutstamp_t deadband_width;
+  /**
+   * @brief   Period deadband copied from the settings.
+   */
+  eicutstamp_t deadband_period;
+  /**
+   * @brief   Refresh time copied from the settings.
+   */
+  eicutstamp_t deadband_refresh;
+  /**
+   * @brief   Deadband references of the width and period events.
+   */
+  EICUDeadband db[2];
+#endif
+#if EICU_USE_TIMEBASE || defined(__DOXYGEN__)
+  /**
+   * @brief   Reference period copied from the settings.
+   */
+  uint32_t ref_period;
+  /**
+   * @brief   Timebase filter copied from the settings.
+   */
+  uint8_t ref_filter;
+#endif
+} EICUChannel;
+
+/**
+ * @brief   Type of a capture dispatch table entry.
+ */
+typedef struct EICUDispatch EICUDispatch;
+
+/**
+ * @brief   EICU capture service routine type.
+ *
+ * @param[in] eicup     Pointer to a EICUDriver object
+ * @param[in] dp        Dispatch entry of the capture flag being served
+ * @param[in] sr        The status register snapshot of the interrupt
+ */
+typedef void (*eicuhandler_t)(EICUDriver *eicup, const EICUDispatch *dp,
+                              uint32_t sr);
+
+/**
+ * @brief EICU capture dispatch table entry structure definition.
+ * @details One entry for each CC flag, resolved in @p eicu_lld_start() so
+ *          that the ISR does not need to look at the configuration. The
+ *          settings the ISR needs are copied in the @p EICUChannel of the
+ *          reported channel.
+ */
+struct EICUDispatch
+{
+  /**
+   * @brief   Service routine of the input type.
+   */
+  eicuhandler_t handler;
+  /**
+   * @brief   Callback of the event, width or period.
+   */
+  eicucallback_t cb;
+  /**
+   * @brief   Period callback of the start edges, multi-channel PWM only.
+   */
+  eicucallback_t pcb;
+  /**
+   * @brief   Channel reported to the callback.
+   */
+  eicuchannel_t channel;
+};
+
 /** 
  * @brief EICU Input Capture Driver structure definition  
  */
@@ -359,9 +1154,129 @@ struct EICUDriver
    */
   eicustate_t state;
   /**
-   * @brief   Temporary width holder during pulse measurement.
+   * @brief   Timebase at the latest counter overflow.
+   * @note    In PWM mode it is relative to the latest counter reset.
+   */
+  eicutstamp_t epoch;
+  /**
+   * @brief   Run-time data of each channel.
+   */
+  EICUChannel channels[4];
+  /**
+   * @brief   Capture dispatch table, indexed by CC flag.
+   */
+  EICUDispatch dispatch[4];
+  /**
+   * @brief   Enabled interrupt sources, copy of the DIER IRQ bits.
+   */
+  uint32_t irqmask;
+  /**
+   * @brief   CC flags served after the others in the same interrupt.
+   */
+  uint32_t late;
+  /**
+   * @brief   Channels with an input loss timeout.
+   */
+  uint32_t tmask;
+  /**
+   * @brief   Hall state sampled at the latest transition, channel 1 in
+   *          bit 0.
    */
-  eicucnt_t last_count[4];
+  uint8_t hall;
+  /**
+   * @brief   Channels captured since the latest counter overflow.
+   */
+  uint32_t seen;
+#if EICU_USE_ENCODER || defined(__DOXYGEN__)
+  /**
+   * @brief   Encoder position at the latest position change.
+   */
+  int32_t enc_pos;
+  /**
+   * @brief   System time at the latest position change.
+   */
+  systime_t enc_time;
+  /**
+   * @brief   Latest encoder velocity estimate.
+   */
+  int32_t enc_vel;
+#endif
+#if EICU_USE_TIMEBASE || defined(__DOXYGEN__)
+  /**
+   * @brief   Reference disciplined timebase.
+   */
+  EICUTimebase timebase;
+#endif
+#if STM32_EICU_HAS_32BIT_TIMERS || defined(__DOXYGEN__)
+  /**
+   * @brief   Counter top value, depends on the timer width.
+   */
+  eicucnt_t top;
+#endif
+#if EICU_USE_STATISTICS || defined(__DOXYGEN__)
+  /**
+   * @brief   Interrupt statistics.
+   */
+  EICUStats stats;
+#endif
+#if EICU_USE_PPM || defined(__DOXYGEN__)
+  /**
+   * @brief   PPM frame decoder.
+   */
+  EICUPPM ppm;
+#endif
+#if EICU_USE_QUEUE || defined(__DOXYGEN__)
+  /**
+   * @brief   Capture queue write index, only written by the ISR.
+   */
+  volatile size_t qwr;
+  /**
+   * @brief   Capture queue read index, only written by the consumer.
+   */
+  volatile size_t qrd;
+  /**
+   * @brief   Number of records the waiting thread needs.
+   */
+  size_t qwanted;
+  /**
+   * @brief   Waiting thread.
+   */
+  thread_reference_t thread;
+  /**
+   * @brief   Capture queue buffer copied from the configuration.
+   */
+  EICUCapture *qbuf;
+  /**
+   * @brief   Capture queue size copied from the configuration.
+   */
+  size_t qsize;
+#endif
+  /**
+   * @brief   Input type copied from the configuration.
+   */
+  eicuinput_t input_type;
+  /**
+   * @brief   Overflow callback copied from the configuration.
+   */
+  eicucallback_t overflow_cb;
+  /**
+   * @brief   Overcapture callback copied from the configuration.
+   */
+  eicucallback_t error_cb;
+  /**
+   * @brief   Input loss callback copied from the configuration.
+   */
+  eicucallback_t timeout_cb;
+#if EICU_USE_EVENTS || defined(__DOXYGEN__)
+  /**
+   * @brief   Measurement event source.
+   */
+  event_source_t event;
+  /**
+   * @brief   Event flags collected during the interrupt.
+   */
+  eventflags_t eflags;
+#endif
   /**
    * @brief   Timer base clock.
    */
@@ -379,34 +1294,188 @@ struct EICUDriver
    * @note    Only one is needed since only one PWM input per timer is allowed.
    */
   volatile uint32_t *pccrp;
+#if STM32_EICU_USE_DMA || defined(__DOXYGEN__)
+  /**
+   * @brief   DMA capture channels.
+   */
+  EICUDMAChannel dma[4];
+#endif
 };
 
 /*===========================================================================*/
 /* Driver macros.                                                            */
 /*===========================================================================*/
 
+/**
+ * @brief   Returns the width of the latest pulse.
+ * @details The pulse width is defined as number of ticks between the start
+ *          edge and the stop edge.
+ *
+ * @param[in] eicup     Pointer to the EICUDriver object.
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @return              The number of ticks.
+ *
+ * @notapi
+ */
+#define eicu_lld_get_width(eicup, channel) ((eicup)->channels[(channel)].width)
+
 /**
  * @brief   Returns the width of the latest cycle.
  * @details The cycle width is defined as number of ticks between a start
  *          edge and the next start edge.
  *
  * @param[in] eicup     Pointer to the EICUDriver object.
+ * @param[in] channel   The timer channel that fired the interrupt.
  * @return              The number of ticks.
  *
  * @notapi
  */
-#define eicu_lld_get_period(eicup) (*((eicup)->pccrp) + 1)
+#define eicu_lld_get_period(eicup, channel)                                    \
+  ((eicup)->channels[(channel)].period)
+
+/**
+ * @brief   Returns the timestamp of the latest measurement.
+ *
+ * @param[in] eicup     Pointer to the EICUDriver object.
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @return              The extended timestamp.
+ *
+ * @notapi
+ */
+#define eicu_lld_get_timestamp(eicup, channel)                                 \
+  ((eicup)->channels[(channel)].stamp)
+
+/**
+ * @brief   Returns the aggregation of the latest closed window.
+ *
+ * @param[in] eicup     Pointer to the EICUDriver object.
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @return              Pointer to the @p EICUAggregate of the window.
+ *
+ * @notapi
+ */
+#define eicu_lld_get_aggregate(eicup, channel)                                 \
+  ((const EICUAggregate *)&(eicup)->channels[(channel)].agg)
+
+/**
+ * @brief   Returns the average of the latest intervals.
+ *
+ * @param[in] eicup     Pointer to the EICUDriver object.
+ * @param[in] channel   The start channel of the pair.
+ * @return              The signed average interval in 1/256 ticks.
+ *
+ * @notapi
+ */
+#define eicu_lld_get_interval_average(eicup, channel)                          \
+  ((eicup)->channels[(channel)].iavg)
+
+/**
+ * @brief   Returns the hall state sampled at the latest transition.
+ *
+ * @param[in] eicup     Pointer to the EICUDriver object.
+ * @return              The hall inputs levels, channel 1 in bit 0.
+ *
+ * @notapi
+ */
+#define eicu_lld_get_hall_state(eicup) ((eicup)->hall)
+
+/**
+ * @brief   Returns the frequency measured over the latest gate.
+ * @details Reciprocal counting, edges counted over the ticks between the
+ *          first and the last edge of the gate.
+ *
+ * @param[in] eicup     Pointer to the EICUDriver object.
+ * @param[in] channel   The timer channel that fired the interrupt.
+ * @return              The frequency in millihertz.
+ *
+ * @notapi
+ */
+#define eicu_lld_get_frequency(eicup, channel)                                 \
+  ((uint32_t)(((uint64_t)(eicup)->channels[(channel)].count *                  \
+               (eicup)->config->frequency * 1000U) /                           \
+              (eicup)->channels[(channel)].width))
 
 /**
  * @brief   Returns the compare value of the latest cycle.
  *
  * @param[in] eicup     Pointer to the EICUDriver object.
  * @param[in] channel   The timer channel that fired the interrupt.
- * @return              The number of ticks.
+ * @return              The captured counter value.
  *
  * @notapi
  */
-#define eicu_lld_get_compare(eicup, channel) (*((eicup)->wccrp[(channel)]) + 1)
+#define eicu_lld_get_compare(eicup, channel)                                   \
+  ((eicucnt_t)*((eicup)->wccrp[(channel)]))
+
+/**
+ * @brief   Returns the counter top value of a driver.
+ *
+ * @param[in] eicup     Pointer to the EICUDriver object.
+ * @return              The ARR value.
+ *
+ * @notapi
+ */
+#if STM32_EICU_HAS_32BIT_TIMERS || defined(__DOXYGEN__)
+#define eicu_lld_get_top(eicup) ((eicup)->top)
+#else
+#define eicu_lld_get_top(eicup) ((eicucnt_t)EICU_LLD_TOP_16BITS)
+#endif
+
+/**
+ * @brief   Ticks added to the timebase on each counter overflow.
+ * @note    With a 32 bits counter and 32 bits timestamps it is zero.
+ *
+ * @param[in] eicup     Pointer to the EICUDriver object.
+ * @return              The epoch increment.
+ *
+ * @notapi
+ */
+#define eicu_lld_get_epoch_increment(eicup)                                    \
+  ((eicutstamp_t)eicu_lld_get_top(eicup) + 1)
+
+/**
+ * @brief   Checks if a pending overflow happened before a capture.
+ * @details When the overflow and the capture flags are read together the
+ *          capture precedes the overflow if it lies in the upper half of the
+ *          counter range, else it follows it.
+ *
+ * @param[in] eicup     Pointer to the EICUDriver object.
+ * @param[in] capture   The captured counter value.
+ * @param[in] sr        The status register snapshot of the interrupt.
+ * @return              The overflow precedes the capture.
+ *
+ * @notapi
+ */
+#define eicu_lld_overflow_before(eicup, capture, sr)                           \
+  ((((sr) & STM32_TIM_SR_UIF) != 0) &&                                         \
+   ((capture) <= (eicu_lld_get_top(eicup) >> 1)))
+
+/**
+ * @brief   Checks if an extended timestamp precedes another one.
+ *
+ * @param[in] a         The first timestamp.
+ * @param[in] b         The second timestamp.
+ * @return              @p a is older than @p b.
+ *
+ * @notapi
+ */
+#define eicu_lld_is_before(a, b)                                               \
+  ((eicutstamp_t)((a) - (b)) > ((eicutstamp_t)-1 >> 1))
+
+/**
+ * @brief   Extends a captured counter value with the overflow epoch.
+ *
+ * @param[in] eicup     Pointer to the EICUDriver object.
+ * @param[in] capture   The captured counter value.
+ * @param[in] sr        The status register snapshot of the interrupt.
+ * @return              The extended timestamp.
+ *
+ * @notapi
+ */
+#define eicu_lld_extend(eicup, capture, sr)                                    \
+  ((eicup)->epoch + (eicutstamp_t)(capture) +                                  \
+   (eicu_lld_overflow_before((eicup), (capture), (sr)) ?                       \
+    eicu_lld_get_epoch_increment(eicup) : 0))
 
 /**
  * @brief   Inverts the polarity for the given channel.
@@ -461,7 +1530,10 @@ extern "C" {
   void eicu_lld_stop(EICUDriver *eicup);
   void eicu_lld_enable(EICUDriver *eicup);
   void eicu_lld_disable(EICUDriver *eicup);
-  uint16_t eicu_lld_get_width(EICUDriver *eicup, uint16_t channel);
+#if EICU_USE_ENCODER
+  int32_t eicu_lld_get_position(EICUDriver *eicup);
+  int32_t eicu_lld_get_velocity(EICUDriver *eicup);
+#endif
 #ifdef __cplusplus
 }
 #endif